@@ -4,6 +4,54 @@
 // https://github.com/libsdl-org/SDL_shadercross/issues/211
 #include "../src/config.hpp"
 
+static const uint kSolverResidual = 0;
+static const uint kSolverConverged = 1;
+static const uint kSolverIterations = 2;
+static const uint kSolverLastResidual = 3;
+static const uint kSolverSolves = 4;
+static const uint kSolverModeReset = 0;
+static const uint kSolverModeCheck = 1;
+static const uint kSolverModeStore = 2;
+static const uint kResidualWrite = 1;
+static const uint kResidualReduce = 2;
+static const int kTypeCombined = 6;
+static const float kDyeStrength = 0.8f;
+static const float kVelocityScale = 2.0f;
+static const uint kBrickArguments = 0;
+static const uint kBrickCount = 3;
+static const uint kBrickList = 4;
+static const uint kBrickMaxGroups = 65535;
+static const uint kBrickActive = 1;
+static const uint kBrickWasActive = 2;
+static const uint kBrickModeReset = 0;
+static const uint kBrickModeCompact = 1;
+static const uint kBrickModeFill = 2;
+static const uint kBrickModeMark = 3;
+static const uint kBrickModeArguments = 4;
+
+int GetResolution(int3 size)
+{
+    return max(max(size.x, size.y), size.z);
+}
+
+uint PackBrick(int3 brick)
+{
+    return brick.x | (brick.y << 10) | (brick.z << 20);
+}
+
+bool GetBrick(StructuredBuffer<uint> inBricks, uint3 group, out int3 position)
+{
+    uint index = group.y * kBrickMaxGroups + group.x;
+    position = int3(0, 0, 0);
+    if (index >= inBricks[kBrickCount])
+    {
+        return false;
+    }
+    uint brick = inBricks[kBrickList + index];
+    position = int3(brick & 0x3FF, (brick >> 10) & 0x3FF, brick >> 20) * THREADS;
+    return true;
+}
+
 void LinSolve(int3 id, Texture3D<float> inImage, RWTexture3D<float> outImage, float a, float c)
 {
     outImage[id] =
@@ -16,53 +64,90 @@ void LinSolve(int3 id, Texture3D<float> inImage, RWTexture3D<float> outImage, fl
                  outImage[id + int3( 0, 0,-1 )])) / c;
 }
 
-void Advect(
+float GetBoundaryScale(int3 id, int3 size, uint type)
+{
+    float3 signs = 1.0f;
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (id[i] == 0 || id[i] == size[i] - 1)
+        {
+            signs[i] = type == i + 1 ? -1.0f : 1.0f;
+            count++;
+        }
+    }
+    if (count == 3)
+    {
+        return 0.33f * (signs.y * signs.z + signs.x * signs.z + signs.x * signs.y);
+    }
+    return signs.x * signs.y * signs.z;
+}
+
+struct Backtrace
+{
+    int3 Index0;
+    int3 Index1;
+    float3 Weight0;
+    float3 Weight1;
+};
+
+Backtrace GetBacktrace(
     int3 id,
-    RWTexture3D<float> outImage,
-    Texture3D<float> inImage,
     Texture3D<float> inVelocityX,
     Texture3D<float> inVelocityY,
     Texture3D<float> inVelocityZ,
     float deltaTime,
     int3 size)
 {
-    float N = size.x - 2;
+    float N = GetResolution(size) - 2;
+    float3 limit = float3(size) - 1.5f;
     float dtx = deltaTime * N;
     float dty = deltaTime * N;
     float dtz = deltaTime * N;
     float tmp1 = dtx * inVelocityX.Load(int4(id, 0));
     float tmp2 = dty * inVelocityY.Load(int4(id, 0));
     float tmp3 = dtz * inVelocityZ.Load(int4(id, 0));
-    float x = clamp(id.x - tmp1, 0.5f, N + 0.5f);
-    float y = clamp(id.y - tmp2, 0.5f, N + 0.5f);
-    float z = clamp(id.z - tmp3, 0.5f, N + 0.5f);
-    float i0 = floor(x);
-    float i1 = i0 + 1.0f;
-    float j0 = floor(y);
-    float j1 = j0 + 1.0f;
-    float k0 = floor(z);
-    float k1 = k0 + 1.0f;
-    float s1 = x - i0;
-    float s0 = 1.0f - s1;
-    float t1 = y - j0;
-    float t0 = 1.0f - t1;
-    float u1 = z - k0;
-    float u0 = 1.0f - u1;
-    int i0i = int(i0);
-    int i1i = int(i1);
-    int j0i = int(j0);
-    int j1i = int(j1);
-    int k0i = int(k0);
-    int k1i = int(k1);
-    outImage[id] =
-        s0 * (t0 * (u0 * inImage.Load(int4(i0i, j0i, k0i, 0)) +
-                    u1 * inImage.Load(int4(i0i, j0i, k1i, 0))) +
-             (t1 * (u0 * inImage.Load(int4(i0i, j1i, k0i, 0)) +
-                    u1 * inImage.Load(int4(i0i, j1i, k1i, 0))))) +
-        s1 * (t0 * (u0 * inImage.Load(int4(i1i, j0i, k0i, 0)) +
-                    u1 * inImage.Load(int4(i1i, j0i, k1i, 0))) +
-             (t1 * (u0 * inImage.Load(int4(i1i, j1i, k0i, 0)) +
-                    u1 * inImage.Load(int4(i1i, j1i, k1i, 0)))));
+    float x = clamp(id.x - tmp1, 0.5f, limit.x);
+    float y = clamp(id.y - tmp2, 0.5f, limit.y);
+    float z = clamp(id.z - tmp3, 0.5f, limit.z);
+    float3 index0 = floor(float3(x, y, z));
+    Backtrace backtrace;
+    backtrace.Index0 = int3(index0);
+    backtrace.Index1 = int3(index0 + 1.0f);
+    backtrace.Weight1 = float3(x, y, z) - index0;
+    backtrace.Weight0 = 1.0f - backtrace.Weight1;
+    return backtrace;
+}
+
+float Interpolate(Texture3D<float> inImage, Backtrace backtrace)
+{
+    int3 i0 = backtrace.Index0;
+    int3 i1 = backtrace.Index1;
+    float3 w0 = backtrace.Weight0;
+    float3 w1 = backtrace.Weight1;
+    return
+        w0.x * (w0.y * (w0.z * inImage.Load(int4(i0.x, i0.y, i0.z, 0)) +
+                        w1.z * inImage.Load(int4(i0.x, i0.y, i1.z, 0))) +
+               (w1.y * (w0.z * inImage.Load(int4(i0.x, i1.y, i0.z, 0)) +
+                        w1.z * inImage.Load(int4(i0.x, i1.y, i1.z, 0))))) +
+        w1.x * (w0.y * (w0.z * inImage.Load(int4(i1.x, i0.y, i0.z, 0)) +
+                        w1.z * inImage.Load(int4(i1.x, i0.y, i1.z, 0))) +
+               (w1.y * (w0.z * inImage.Load(int4(i1.x, i1.y, i0.z, 0)) +
+                        w1.z * inImage.Load(int4(i1.x, i1.y, i1.z, 0)))));
+}
+
+void Advect(
+    int3 id,
+    RWTexture3D<float> outImage,
+    Texture3D<float> inImage,
+    Texture3D<float> inVelocityX,
+    Texture3D<float> inVelocityY,
+    Texture3D<float> inVelocityZ,
+    float deltaTime,
+    int3 size)
+{
+    Backtrace backtrace = GetBacktrace(id, inVelocityX, inVelocityY, inVelocityZ, deltaTime, size);
+    outImage[id] = Interpolate(inImage, backtrace);
 }
 
 #endif
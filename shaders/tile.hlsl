@@ -0,0 +1,115 @@
+#ifndef TILE_HLSL
+#define TILE_HLSL
+
+#include "shader.hlsl"
+
+static const int kTileHalo = 2 * TILE_SWEEPS;
+static const int kTileSize = THREADS + 2 * kTileHalo;
+static const int kTileCells = kTileSize * kTileSize * kTileSize;
+static const int kTileThreads = THREADS * THREADS * THREADS;
+static const int kTileLoads = (kTileCells + kTileThreads - 1) / kTileThreads;
+
+groupshared float tileImage[kTileCells];
+
+int3 GetTilePosition(int index)
+{
+    return int3(index % kTileSize, (index / kTileSize) % kTileSize, index / (kTileSize * kTileSize));
+}
+
+int GetTileIndex(int3 position)
+{
+    return (position.z * kTileSize + position.y) * kTileSize + position.x;
+}
+
+// Runs TILE_SWEEPS red-black sweeps (each followed by the boundary update) on a haloed brick in
+// groupshared memory. The halo shrinks by one cell per half sweep, so the core matches global sweeps
+void TileSolve(
+    int3 group,
+    int index,
+    Texture3D<float> inImage,
+    Texture3D<float> inSource,
+    RWTexture3D<float> outImage,
+    float a,
+    float c,
+    uint type)
+{
+    uint width;
+    uint height;
+    uint depth;
+    inImage.GetDimensions(width, height, depth);
+    int3 size = int3(width, height, depth);
+    int3 origin = group * THREADS - kTileHalo;
+    float sources[kTileLoads];
+    for (int i = 0; i < kTileLoads; i++)
+    {
+        int cell = index + i * kTileThreads;
+        int3 id = origin + GetTilePosition(cell);
+        sources[i] = 0.0f;
+        if (cell >= kTileCells)
+        {
+            continue;
+        }
+        float value = 0.0f;
+        if (all(id >= 0) && all(id < size))
+        {
+            value = inImage.Load(int4(id, 0));
+            sources[i] = inSource.Load(int4(id, 0));
+        }
+        tileImage[cell] = value;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    for (int sweep = 0; sweep < TILE_SWEEPS; sweep++)
+    {
+        for (int phase = 0; phase < 2; phase++)
+        {
+            for (int i = 0; i < kTileLoads; i++)
+            {
+                int cell = index + i * kTileThreads;
+                int3 position = GetTilePosition(cell);
+                int3 id = origin + position;
+                if (cell >= kTileCells || any(position < 1) || any(position >= kTileSize - 1) ||
+                    any(id < 1) || any(id >= size - 1) || ((id.x + id.y + id.z + phase) & 1))
+                {
+                    continue;
+                }
+                tileImage[cell] =
+                    (sources[i] +
+                        a * (tileImage[cell + 1] +
+                             tileImage[cell - 1] +
+                             tileImage[cell + kTileSize] +
+                             tileImage[cell - kTileSize] +
+                             tileImage[cell + kTileSize * kTileSize] +
+                             tileImage[cell - kTileSize * kTileSize])) / c;
+            }
+            GroupMemoryBarrierWithGroupSync();
+        }
+        for (int i = 0; i < kTileLoads; i++)
+        {
+            int cell = index + i * kTileThreads;
+            int3 id = origin + GetTilePosition(cell);
+            if (cell >= kTileCells || any(id < 0) || any(id >= size) || (all(id > 0) && all(id < size - 1)))
+            {
+                continue;
+            }
+            int3 source = clamp(id, 1, size - 2) - origin;
+            if (any(source < 0) || any(source >= kTileSize))
+            {
+                continue;
+            }
+            tileImage[cell] = tileImage[GetTileIndex(source)] * GetBoundaryScale(id, size, type);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    for (int i = 0; i < kTileLoads; i++)
+    {
+        int cell = index + i * kTileThreads;
+        int3 position = GetTilePosition(cell);
+        int3 id = origin + position;
+        if (cell < kTileCells && all(position >= kTileHalo) && all(position < kTileHalo + THREADS) && all(id < size))
+        {
+            outImage[id] = tileImage[cell];
+        }
+    }
+}
+
+#endif
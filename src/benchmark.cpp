@@ -0,0 +1,490 @@
+#include <SDL3/SDL.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "cpu.hpp"
+#include "linsolve.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+static constexpr const char* GpuModes[] =
+{
+    "RedBlack",
+    "Multigrid",
+    "Adaptive",
+    "Tiled",
+    "Sparse",
+};
+
+static constexpr const char* GpuModeFlags[] =
+{
+    nullptr,
+    "--multigrid",
+    "--adaptive",
+    "--tiled",
+    "--sparse",
+};
+
+static std::vector<std::string> scenes;
+static std::string samples = "samples";
+static std::string output;
+static std::vector<int> sizes = {64, 128};
+static std::vector<int> iterations = {7};
+static int steps = 50;
+static int warmup = 5;
+static int threads;
+static LinSolveIsa isa = GetBestLinSolveIsa();
+static std::string gpu;
+static std::vector<int> modes = {0, 1, 2, 3, 4};
+static bool compare;
+static float tolerance = INFINITY;
+static std::vector<float> reference;
+static ThreadPool pool;
+static bool failed;
+
+static bool ParseList(const char* value, std::vector<int>& list)
+{
+    list.clear();
+    for (const char* token = value; *token; token++)
+    {
+        char* end;
+        int number = std::strtol(token, &end, 10);
+        if (end == token || number <= 0)
+        {
+            return false;
+        }
+        list.push_back(number);
+        token = end;
+        if (!*token)
+        {
+            break;
+        }
+        if (*token != ',')
+        {
+            return false;
+        }
+    }
+    return !list.empty();
+}
+
+static bool ParseModes(const char* value, std::vector<int>& list)
+{
+    list.clear();
+    std::string names = value;
+    for (size_t begin = 0; begin <= names.size();)
+    {
+        size_t end = std::min(names.find(',', begin), names.size());
+        std::string name = names.substr(begin, end - begin);
+        int mode = 0;
+        while (mode < SDL_arraysize(GpuModes) && name != GpuModes[mode])
+        {
+            mode++;
+        }
+        if (mode == SDL_arraysize(GpuModes))
+        {
+            return false;
+        }
+        list.push_back(mode);
+        begin = end + 1;
+    }
+    return !list.empty();
+}
+
+static bool ParseArgs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            scenes.push_back(argv[i]);
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--compare"))
+        {
+            compare = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            SDL_Log("Missing value: %s", argv[i]);
+            return false;
+        }
+        const char* value = argv[++i];
+        if (!std::strcmp(argv[i - 1], "--samples"))
+        {
+            samples = value;
+        }
+        else if (!std::strcmp(argv[i - 1], "--output"))
+        {
+            output = value;
+        }
+        else if (!std::strcmp(argv[i - 1], "--sizes"))
+        {
+            if (!ParseList(value, sizes) || std::any_of(sizes.begin(), sizes.end(), [](int size) { return size < 4; }))
+            {
+                SDL_Log("Invalid sizes: %s", value);
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i - 1], "--iterations"))
+        {
+            if (!ParseList(value, iterations))
+            {
+                SDL_Log("Invalid iterations: %s", value);
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i - 1], "--steps"))
+        {
+            steps = std::atoi(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--warmup"))
+        {
+            warmup = std::atoi(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--threads"))
+        {
+            threads = std::atoi(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--gpu"))
+        {
+            gpu = value;
+        }
+        else if (!std::strcmp(argv[i - 1], "--modes"))
+        {
+            if (!ParseModes(value, modes))
+            {
+                SDL_Log("Invalid modes: %s", value);
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i - 1], "--tolerance"))
+        {
+            tolerance = std::atof(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--isa"))
+        {
+            isa = GetLinSolveIsa(value);
+            if (isa == LinSolveIsaCount || !IsLinSolveIsaSupported(isa))
+            {
+                SDL_Log("Unsupported isa: %s", value);
+                return false;
+            }
+        }
+        else
+        {
+            SDL_Log("Unknown argument: %s", argv[i - 1]);
+            return false;
+        }
+    }
+    if (steps <= 0 || warmup < 0)
+    {
+        SDL_Log("Invalid arguments: steps %d, warmup %d", steps, warmup);
+        return false;
+    }
+    return true;
+}
+
+static void FindGpu()
+{
+    if (!gpu.empty())
+    {
+        return;
+    }
+    const char* base = SDL_GetBasePath();
+    if (!base)
+    {
+        return;
+    }
+#ifdef SDL_PLATFORM_WINDOWS
+    std::filesystem::path path = std::filesystem::path(base) / "fluid_simulation.exe";
+#else
+    std::filesystem::path path = std::filesystem::path(base) / "fluid_simulation";
+#endif
+    std::error_code error;
+    if (std::filesystem::exists(path, error))
+    {
+        gpu = path.string();
+    }
+    else
+    {
+        SDL_Log("Skipping GPU runs: %s not found", path.string().data());
+    }
+}
+
+static bool FindScenes()
+{
+    if (!scenes.empty())
+    {
+        return true;
+    }
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(samples, error))
+    {
+        if (entry.path().extension() == ".json")
+        {
+            scenes.push_back(entry.path().string());
+        }
+    }
+    if (error || scenes.empty())
+    {
+        SDL_Log("Failed to find scenes: %s", samples.data());
+        return false;
+    }
+    std::sort(scenes.begin(), scenes.end());
+    return true;
+}
+
+static void Step(CpuSolver& solver, const State& state)
+{
+    int size = solver.GetSize();
+    for (const Spawner& spawner : state.Spawners)
+    {
+        if (!spawner.Enabled)
+        {
+            continue;
+        }
+        int position[3];
+        for (int i = 0; i < 3; i++)
+        {
+            position[i] = std::clamp(spawner.Position[i] * size / state.Size[i], 1, size - 2);
+        }
+        solver.Add1(spawner.Texture, position, spawner.Value);
+    }
+    solver.Update();
+}
+
+static nlohmann::ordered_json Run(const std::string& scene, const State& state, int size, int iterations)
+{
+    CpuSolver solver;
+    solver.SetIsa(isa);
+    solver.Iterations = iterations;
+    solver.Create(size, threads);
+    for (int i = 0; i < warmup; i++)
+    {
+        Step(solver, state);
+    }
+    solver.ResetPhaseTimes();
+    Uint64 time1 = SDL_GetTicksNS();
+    for (int i = 0; i < steps; i++)
+    {
+        Step(solver, state);
+    }
+    Uint64 time2 = SDL_GetTicksNS();
+    double seconds = double(time2 - time1) / SDL_NS_PER_SECOND;
+    double cells = double(size) * size * size * steps;
+    nlohmann::ordered_json run;
+    run["Scene"] = std::filesystem::path(scene).filename().string();
+    run["Device"] = "Cpu";
+    run["Size"] = size;
+    run["Iterations"] = iterations;
+    run["Threads"] = solver.GetThreads();
+    run["StepMs"] = seconds * 1000.0 / steps;
+    run["CellsPerSecond"] = cells / seconds;
+    nlohmann::ordered_json phases;
+    for (int i = CpuPhaseNone + 1; i < CpuPhaseCount; i++)
+    {
+        double ms = double(solver.GetPhaseTime(CpuPhase(i))) / SDL_NS_PER_MS;
+        phases[GetCpuPhaseName(CpuPhase(i))] = ms / steps;
+    }
+    run["PhaseMs"] = phases;
+    SDL_Log("%s: Size: %d, Iterations: %d, Step: %.3f ms, Throughput: %.3e cells/s",
+        run["Scene"].get<std::string>().data(), size, iterations, seconds * 1000.0 / steps, cells / seconds);
+    return run;
+}
+
+static bool LoadDensity(const std::string& path, int size, std::vector<float>& density)
+{
+    CheckpointFile file;
+    if (!file.Open(path.data()))
+    {
+        return false;
+    }
+    const CheckpointHeader& header = file.GetHeader();
+    if (header.Size[0] != size || header.Size[1] != size || header.Size[2] != size)
+    {
+        SDL_Log("Unexpected checkpoint size: %s, %d, %d, %d", path.data(), header.Size[0], header.Size[1], header.Size[2]);
+        return false;
+    }
+    density.resize(size_t(size) * size * size);
+    if (!file.ReadField(pool, TextureTypeDensity, density.data()))
+    {
+        return false;
+    }
+    file.Close();
+    std::filesystem::remove(path);
+    return true;
+}
+
+static bool RunGpu(const std::string& scene, int size, int iterations, int mode, nlohmann::ordered_json& run)
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "fluid_benchmark";
+    std::string stepsArg = std::to_string(warmup + steps);
+    std::string warmupArg = std::to_string(warmup);
+    std::string sizeArg = std::to_string(size);
+    std::string iterationsArg = std::to_string(iterations);
+    std::string directoryArg = directory.string();
+    std::vector<const char*> args = {gpu.data(), scene.data(), "--headless", "--steps", stepsArg.data(), "--warmup",
+        warmupArg.data(), "--size", sizeArg.data(), "--iterations", iterationsArg.data(), "--output", directoryArg.data()};
+    if (!compare)
+    {
+        args.push_back("--no-checkpoint");
+    }
+    if (GpuModeFlags[mode])
+    {
+        args.push_back(GpuModeFlags[mode]);
+    }
+    args.push_back(nullptr);
+    SDL_Process* process = SDL_CreateProcess(args.data(), false);
+    if (!process)
+    {
+        SDL_Log("Failed to create process: %s, %s", gpu.data(), SDL_GetError());
+        return false;
+    }
+    int exitCode = 0;
+    SDL_WaitProcess(process, true, &exitCode);
+    SDL_DestroyProcess(process);
+    std::string path = (directory / "run.json").string();
+    std::ifstream file(path);
+    if (exitCode || !file)
+    {
+        SDL_Log("Failed to run: %s, %s", gpu.data(), scene.data());
+        return false;
+    }
+    nlohmann::json result;
+    try
+    {
+        file >> result;
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to load json: %s, %s", path.data(), exception.what());
+        return false;
+    }
+    file.close();
+    std::filesystem::remove(path);
+    double seconds = result["Seconds"].get<double>();
+    double measured = result["Steps"].get<double>();
+    double cells = double(size) * size * size * measured;
+    run["Scene"] = std::filesystem::path(scene).filename().string();
+    run["Device"] = "Gpu";
+    run["Mode"] = GpuModes[mode];
+    run["Size"] = size;
+    run["Iterations"] = iterations;
+    run["StepMs"] = seconds * 1000.0 / measured;
+    run["CellsPerSecond"] = cells / seconds;
+    run["PhaseMs"] = result["PhaseMs"];
+    SDL_Log("%s: Gpu: %s, Size: %d, Iterations: %d, Step: %.3f ms, Throughput: %.3e cells/s",
+        run["Scene"].get<std::string>().data(), GpuModes[mode], size, iterations, seconds * 1000.0 / measured, cells / seconds);
+    if (!compare)
+    {
+        return true;
+    }
+    std::vector<float> density;
+    if (!LoadDensity((directory / "final.ckpt").string(), size, density))
+    {
+        return false;
+    }
+    if (reference.empty())
+    {
+        reference = std::move(density);
+        run["MaxDensityDifference"] = 0.0f;
+        return true;
+    }
+    // NaN propagates so a diverged run never passes the tolerance
+    float difference = 0.0f;
+    for (size_t i = 0; i < density.size(); i++)
+    {
+        float error = std::abs(density[i] - reference[i]);
+        if (!(error <= difference))
+        {
+            difference = error;
+        }
+    }
+    run["MaxDensityDifference"] = difference;
+    SDL_Log("%s: Gpu: %s, Max density difference from %s: %.3e",
+        run["Scene"].get<std::string>().data(), GpuModes[mode], GpuModes[modes.front()], difference);
+    if (!(difference <= tolerance))
+    {
+        SDL_Log("Density difference exceeds tolerance: %s, %.3e", GpuModes[mode], tolerance);
+        failed = true;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseArgs(argc, argv))
+    {
+        SDL_Log("Usage: %s [scene.json...] [--samples DIR] [--sizes N,N] [--iterations N,N] [--steps N] "
+            "[--warmup N] [--threads N] [--isa scalar|sse4|avx2|avx512] [--gpu EXE] "
+            "[--modes RedBlack,Multigrid,Adaptive,Tiled,Sparse] [--compare] [--tolerance F] [--output FILE]", argv[0]);
+        return 1;
+    }
+    if (!FindScenes())
+    {
+        return 1;
+    }
+    FindGpu();
+    if (compare)
+    {
+        pool.Create(threads);
+    }
+    nlohmann::ordered_json report;
+    report["Isa"] = GetLinSolveIsaName(isa);
+    report["Steps"] = steps;
+    report["Warmup"] = warmup;
+    report["Runs"] = nlohmann::ordered_json::array();
+    for (const std::string& scene : scenes)
+    {
+        State state;
+        if (!LoadState(scene.data(), state))
+        {
+            return 1;
+        }
+        for (int size : sizes)
+        {
+            for (int count : iterations)
+            {
+                report["Runs"].push_back(Run(scene, state, size, count));
+                if (gpu.empty())
+                {
+                    continue;
+                }
+                reference.clear();
+                for (int mode : modes)
+                {
+                    nlohmann::ordered_json run;
+                    if (!RunGpu(scene, size, count, mode, run))
+                    {
+                        return 1;
+                    }
+                    report["Runs"].push_back(run);
+                }
+            }
+        }
+    }
+    if (output.empty())
+    {
+        std::cout << report.dump(4) << std::endl;
+        return failed;
+    }
+    std::ofstream file(output);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", output.data());
+        return 1;
+    }
+    file << report.dump(4);
+    return failed;
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include <SDL3/SDL.h>
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "compress.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+static constexpr char kMagic[4] = {'F', 'S', 'C', 'K'};
+static constexpr Uint32 kVersion = 3;
+static constexpr Uint64 kPageSize = 4096;
+
+static Uint64 Align(Uint64 offset)
+{
+    return (offset + kPageSize - 1) / kPageSize * kPageSize;
+}
+
+static Uint64 GetFieldSize(const CheckpointHeader& header)
+{
+    return Uint64(header.Size[0]) * header.Size[1] * header.Size[2] * sizeof(float);
+}
+
+CheckpointFile::~CheckpointFile()
+{
+    Close();
+}
+
+bool CheckpointFile::Open(const char* path)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    LARGE_INTEGER size{};
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping)
+    {
+        Data = static_cast<const Uint8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+    }
+    Size = size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    struct stat info{};
+    void* data = MAP_FAILED;
+    if (!fstat(file, &info) && info.st_size > 0)
+    {
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (data != MAP_FAILED)
+    {
+        madvise(data, info.st_size, MADV_WILLNEED);
+        Data = static_cast<const Uint8*>(data);
+    }
+    Size = info.st_size;
+#endif
+    if (!Data)
+    {
+        SDL_Log("Failed to map file: %s", path);
+        Size = 0;
+        return false;
+    }
+    if (!Validate(path))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CheckpointFile::Close()
+{
+    if (!Data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(Data);
+#else
+    munmap(const_cast<Uint8*>(Data), Size);
+#endif
+    Data = nullptr;
+    Size = 0;
+}
+
+bool CheckpointFile::Validate(const char* path) const
+{
+    if (Size < sizeof(CheckpointHeader))
+    {
+        SDL_Log("Invalid checkpoint: %s", path);
+        return false;
+    }
+    const CheckpointHeader& header = GetHeader();
+    if (std::memcmp(header.Magic, kMagic, sizeof(kMagic)) || header.Version != kVersion || header.FieldCount != TextureTypeCount)
+    {
+        SDL_Log("Invalid checkpoint: %s", path);
+        return false;
+    }
+    if (header.Size[0] < 4 || header.Size[1] < 4 || header.Size[2] < 4)
+    {
+        SDL_Log("Invalid grid size: %d, %d, %d", header.Size[0], header.Size[1], header.Size[2]);
+        return false;
+    }
+    Uint64 end = sizeof(CheckpointHeader);
+    for (const CheckpointField& field : header.Fields)
+    {
+        bool raw = field.Format == CheckpointFormatR32Float;
+        if ((!raw && field.Format != CheckpointFormatCompressed) || (raw && field.Size != GetFieldSize(header)) ||
+            field.Offset % sizeof(float) || field.Offset < end || field.Offset > Size || field.Size > Size - field.Offset)
+        {
+            SDL_Log("Invalid field: %s", path);
+            return false;
+        }
+        end = field.Offset + field.Size;
+    }
+    if (header.SceneOffset > Size || header.SceneSize > Size - header.SceneOffset)
+    {
+        SDL_Log("Invalid scene: %s", path);
+        return false;
+    }
+    return true;
+}
+
+const CheckpointHeader& CheckpointFile::GetHeader() const
+{
+    return *reinterpret_cast<const CheckpointHeader*>(Data);
+}
+
+bool CheckpointFile::ReadField(ThreadPool& pool, TextureType type, float* output) const
+{
+    const CheckpointHeader& header = GetHeader();
+    const CheckpointField& field = header.Fields[type];
+    if (field.Format == CheckpointFormatR32Float)
+    {
+        std::memcpy(output, Data + field.Offset, field.Size);
+        return true;
+    }
+    if (!Decompress(pool, Data + field.Offset, field.Size, output, GetFieldSize(header) / sizeof(float)))
+    {
+        SDL_Log("Failed to decompress field: %d", type);
+        return false;
+    }
+    return true;
+}
+
+bool CheckpointFile::GetState(State& state) const
+{
+    const CheckpointHeader& header = GetHeader();
+    const char* scene = reinterpret_cast<const char*>(Data + header.SceneOffset);
+    try
+    {
+        state = nlohmann::json::parse(scene, scene + header.SceneSize);
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to load json: %s", exception.what());
+        return false;
+    }
+    state.Size = {header.Size[0], header.Size[1], header.Size[2]};
+    return true;
+}
+
+bool IsCheckpoint(const char* path)
+{
+    return std::filesystem::path(path).extension() == ".ckpt";
+}
+
+bool SaveCheckpoint(const char* path, const CheckpointHeader& header, const State& state, const void* data,
+    ThreadPool& pool, CompressionType compression, float errorBound)
+{
+    std::string scene;
+    try
+    {
+        scene = nlohmann::json(state).dump();
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to save json: %s, %s", path, exception.what());
+        return false;
+    }
+    CheckpointHeader fileHeader = header;
+    std::memcpy(fileHeader.Magic, kMagic, sizeof(kMagic));
+    fileHeader.Version = kVersion;
+    fileHeader.FieldCount = TextureTypeCount;
+    Uint64 fieldSize = GetFieldSize(fileHeader);
+    std::vector<Uint8> fields[TextureTypeCount];
+    Uint64 offset = Align(sizeof(fileHeader));
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        CheckpointField& field = fileHeader.Fields[i];
+        field = {};
+        field.Offset = offset;
+        field.Size = fieldSize;
+        field.Format = CheckpointFormatR32Float;
+        if (compression != CompressionTypeNone)
+        {
+            const float* values = reinterpret_cast<const float*>(static_cast<const Uint8*>(data) + i * fieldSize);
+            Compress(pool, compression, errorBound, values, fieldSize / sizeof(float), fields[i]);
+            field.Size = fields[i].size();
+            field.Format = CheckpointFormatCompressed;
+        }
+        offset = Align(offset + field.Size);
+    }
+    fileHeader.SceneOffset = offset;
+    fileHeader.SceneSize = scene.size();
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    std::string padding(kPageSize, '\0');
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(padding.data(), fileHeader.Fields[0].Offset - sizeof(fileHeader));
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        const CheckpointField& field = fileHeader.Fields[i];
+        if (field.Format == CheckpointFormatCompressed)
+        {
+            file.write(reinterpret_cast<const char*>(fields[i].data()), field.Size);
+        }
+        else
+        {
+            file.write(static_cast<const char*>(data) + i * fieldSize, field.Size);
+        }
+        Uint64 end = i + 1 < TextureTypeCount ? fileHeader.Fields[i + 1].Offset : fileHeader.SceneOffset;
+        file.write(padding.data(), end - field.Offset - field.Size);
+    }
+    file.write(scene.data(), scene.size());
+    if (!file)
+    {
+        SDL_Log("Failed to write file: %s", path);
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "compress.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+enum CheckpointFormat
+{
+    CheckpointFormatR32Float,
+    CheckpointFormatCompressed,
+};
+
+struct CheckpointField
+{
+    Uint64 Offset;
+    Uint64 Size;
+    Uint32 Format;
+    Uint32 Padding;
+};
+
+struct CheckpointHeader
+{
+    char Magic[4];
+    Uint32 Version;
+    Sint32 Size[3];
+    Uint32 FieldCount;
+    float Speed;
+    float Diffusion;
+    float Viscosity;
+    Sint32 StepRate;
+    CheckpointField Fields[TextureTypeCount];
+    Uint64 SceneOffset;
+    Uint64 SceneSize;
+};
+
+class CheckpointFile
+{
+public:
+    CheckpointFile() : Data{}, Size{} {}
+    ~CheckpointFile();
+    bool Open(const char* path);
+    void Close();
+    const CheckpointHeader& GetHeader() const;
+    bool ReadField(ThreadPool& pool, TextureType type, float* output) const;
+    bool GetState(State& state) const;
+
+private:
+    bool Validate(const char* path) const;
+
+    const Uint8* Data;
+    Uint64 Size;
+};
+
+bool IsCheckpoint(const char* path);
+bool SaveCheckpoint(const char* path, const CheckpointHeader& header, const State& state, const void* data,
+    ThreadPool& pool, CompressionType compression, float errorBound);
\ No newline at end of file
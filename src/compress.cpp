@@ -0,0 +1,326 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "compress.hpp"
+#include "pool.hpp"
+
+struct CompressionHeader
+{
+    Uint32 Type;
+    float ErrorBound;
+    Uint64 Count;
+    Uint64 Slabs;
+};
+
+static constexpr Uint64 kSlabSize = 1 << 16;
+static constexpr int kMaxLiterals = 128;
+static constexpr int kMaxZeros = 128;
+static constexpr double kQuantizedMargin = 1.0 / 16.0;
+
+enum SlabType : Uint8
+{
+    SlabTypeQuantized,
+    SlabTypeLossless,
+};
+
+static void EncodeRuns(const std::vector<Uint8>& input, std::vector<Uint8>& output)
+{
+    size_t i = 0;
+    while (i < input.size())
+    {
+        size_t zeros = 0;
+        while (i + zeros < input.size() && !input[i + zeros] && zeros < kMaxZeros)
+        {
+            zeros++;
+        }
+        if (zeros >= 2)
+        {
+            output.push_back(Uint8(127 + zeros));
+            i += zeros;
+            continue;
+        }
+        size_t begin = i;
+        while (i < input.size() && i - begin < kMaxLiterals && !(i + 1 < input.size() && !input[i] && !input[i + 1]))
+        {
+            i++;
+        }
+        output.push_back(Uint8(i - begin - 1));
+        output.insert(output.end(), input.begin() + begin, input.begin() + i);
+    }
+}
+
+static bool DecodeRuns(const Uint8* input, size_t size, Uint8* output, size_t count)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < size;)
+    {
+        Uint8 control = input[i++];
+        size_t length = control >= 128 ? control - 127 : control + 1;
+        if (j + length > count || (control < 128 && i + length > size))
+        {
+            return false;
+        }
+        if (control >= 128)
+        {
+            std::memset(output + j, 0, length);
+        }
+        else
+        {
+            std::memcpy(output + j, input + i, length);
+            i += length;
+        }
+        j += length;
+    }
+    return j == count;
+}
+
+static void EncodeLossless(const float* data, Uint64 count, std::vector<Uint8>& bytes)
+{
+    size_t base = bytes.size();
+    bytes.resize(base + count * sizeof(float));
+    Uint32 previous = 0;
+    for (Uint64 i = 0; i < count; i++)
+    {
+        Uint32 bits;
+        std::memcpy(&bits, &data[i], sizeof(bits));
+        Uint32 delta = bits ^ previous;
+        previous = bits;
+        for (int j = 0; j < 4; j++)
+        {
+            bytes[base + j * count + i] = Uint8(delta >> (8 * j));
+        }
+    }
+}
+
+static void DecodeLossless(const Uint8* bytes, float* output, Uint64 count)
+{
+    Uint32 previous = 0;
+    for (Uint64 i = 0; i < count; i++)
+    {
+        Uint32 delta = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            delta |= Uint32(bytes[j * count + i]) << (8 * j);
+        }
+        previous ^= delta;
+        std::memcpy(&output[i], &previous, sizeof(previous));
+    }
+}
+
+// The step is shrunk so rounding the reconstruction to float stays inside the bound for values up to
+// about 2^20 error bounds. Anything else fails the check below and the slab falls back to lossless
+static double GetQuantizedStep(float errorBound)
+{
+    return 2.0 * errorBound * (1.0 - kQuantizedMargin);
+}
+
+static bool EncodeQuantized(const float* data, Uint64 count, float errorBound, std::vector<Uint8>& bytes)
+{
+    double step = GetQuantizedStep(errorBound);
+    if (!(step > 0.0))
+    {
+        return false;
+    }
+    Sint64 previous = 0;
+    for (Uint64 i = 0; i < count; i++)
+    {
+        if (!std::isfinite(data[i]))
+        {
+            return false;
+        }
+        double value = std::round(data[i] / step);
+        if (std::fabs(value) > INT32_MAX || std::fabs(double(float(value * step)) - data[i]) > errorBound)
+        {
+            return false;
+        }
+        Sint64 quantized = Sint64(value);
+        Sint64 delta = quantized - previous;
+        previous = quantized;
+        Uint64 zigzag = (Uint64(delta) << 1) ^ Uint64(delta >> 63);
+        do
+        {
+            Uint8 byte = zigzag & 0x7F;
+            zigzag >>= 7;
+            bytes.push_back(zigzag ? byte | 0x80 : byte);
+        }
+        while (zigzag);
+    }
+    return true;
+}
+
+static bool DecodeQuantized(const Uint8* bytes, size_t size, float* output, Uint64 count, float errorBound)
+{
+    double step = GetQuantizedStep(errorBound);
+    Sint64 previous = 0;
+    size_t j = 0;
+    for (Uint64 i = 0; i < count; i++)
+    {
+        Uint64 zigzag = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            if (j >= size || shift > 63)
+            {
+                return false;
+            }
+            Uint8 byte = bytes[j++];
+            zigzag |= Uint64(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+        previous += Sint64(zigzag >> 1) ^ -Sint64(zigzag & 1);
+        output[i] = float(previous * step);
+    }
+    return j == size;
+}
+
+static void EncodeSlab(CompressionType type, float errorBound, const float* data, Uint64 count, std::vector<Uint8>& output)
+{
+    std::vector<Uint8> bytes;
+    switch (type)
+    {
+    case CompressionTypeLossless:
+        EncodeLossless(data, count, bytes);
+        break;
+    case CompressionTypeQuantized:
+        bytes.reserve(count + 1);
+        bytes.push_back(SlabTypeQuantized);
+        if (!EncodeQuantized(data, count, errorBound, bytes))
+        {
+            bytes.assign(1, SlabTypeLossless);
+            EncodeLossless(data, count, bytes);
+        }
+        break;
+    default:
+        bytes.resize(count * sizeof(float));
+        std::memcpy(bytes.data(), data, bytes.size());
+        break;
+    }
+    EncodeRuns(bytes, output);
+}
+
+static bool DecodeSlab(CompressionType type, float errorBound, const Uint8* data, Uint64 size, float* output, Uint64 count)
+{
+    std::vector<Uint8> bytes;
+    if (type == CompressionTypeQuantized)
+    {
+        size_t length = 0;
+        for (Uint64 i = 0; i < size;)
+        {
+            Uint8 control = data[i];
+            length += control >= 128 ? control - 127 : control + 1;
+            i += control >= 128 ? 1 : control + 2;
+        }
+        bytes.resize(length);
+        if (!DecodeRuns(data, size, bytes.data(), bytes.size()) || bytes.empty())
+        {
+            return false;
+        }
+        if (bytes[0] == SlabTypeLossless && bytes.size() == 1 + count * sizeof(float))
+        {
+            DecodeLossless(bytes.data() + 1, output, count);
+            return true;
+        }
+        return bytes[0] == SlabTypeQuantized && DecodeQuantized(bytes.data() + 1, bytes.size() - 1, output, count, errorBound);
+    }
+    bytes.resize(count * sizeof(float));
+    if (!DecodeRuns(data, size, bytes.data(), bytes.size()))
+    {
+        return false;
+    }
+    if (type == CompressionTypeLossless)
+    {
+        DecodeLossless(bytes.data(), output, count);
+    }
+    else
+    {
+        std::memcpy(output, bytes.data(), bytes.size());
+    }
+    return true;
+}
+
+void Compress(ThreadPool& pool, CompressionType type, float errorBound, const float* data, Uint64 count, std::vector<Uint8>& output)
+{
+    CompressionHeader header{};
+    header.Type = type;
+    header.ErrorBound = errorBound;
+    header.Count = count;
+    header.Slabs = (count + kSlabSize - 1) / kSlabSize;
+    std::vector<std::vector<Uint8>> slabs(header.Slabs);
+    pool.For(0, header.Slabs, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            Uint64 offset = i * kSlabSize;
+            EncodeSlab(type, errorBound, data + offset, std::min(kSlabSize, count - offset), slabs[i]);
+        }
+    });
+    Uint64 size = sizeof(header) + header.Slabs * sizeof(Uint64);
+    for (const std::vector<Uint8>& slab : slabs)
+    {
+        size += slab.size();
+    }
+    output.resize(size);
+    Uint8* pointer = output.data();
+    std::memcpy(pointer, &header, sizeof(header));
+    pointer += sizeof(header);
+    for (const std::vector<Uint8>& slab : slabs)
+    {
+        Uint64 slabSize = slab.size();
+        std::memcpy(pointer, &slabSize, sizeof(slabSize));
+        pointer += sizeof(slabSize);
+    }
+    for (const std::vector<Uint8>& slab : slabs)
+    {
+        std::memcpy(pointer, slab.data(), slab.size());
+        pointer += slab.size();
+    }
+}
+
+bool Decompress(ThreadPool& pool, const Uint8* data, Uint64 size, float* output, Uint64 count)
+{
+    CompressionHeader header;
+    if (size < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.Type >= CompressionTypeCount || header.Count != count ||
+        header.Slabs != (count + kSlabSize - 1) / kSlabSize || header.Slabs > (size - sizeof(header)) / sizeof(Uint64))
+    {
+        return false;
+    }
+    std::vector<Uint64> offsets(header.Slabs + 1);
+    offsets[0] = sizeof(header) + header.Slabs * sizeof(Uint64);
+    for (Uint64 i = 0; i < header.Slabs; i++)
+    {
+        Uint64 slabSize;
+        std::memcpy(&slabSize, data + sizeof(header) + i * sizeof(Uint64), sizeof(slabSize));
+        if (slabSize > size - offsets[i])
+        {
+            return false;
+        }
+        offsets[i + 1] = offsets[i] + slabSize;
+    }
+    std::atomic<bool> valid = true;
+    pool.For(0, header.Slabs, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            Uint64 offset = i * kSlabSize;
+            if (!DecodeSlab(CompressionType(header.Type), header.ErrorBound, data + offsets[i], offsets[i + 1] - offsets[i],
+                output + offset, std::min(kSlabSize, count - offset)))
+            {
+                valid = false;
+            }
+        }
+    });
+    return valid;
+}
\ No newline at end of file
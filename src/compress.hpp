@@ -0,0 +1,18 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+#include "pool.hpp"
+
+enum CompressionType
+{
+    CompressionTypeNone,
+    CompressionTypeLossless,
+    CompressionTypeQuantized,
+    CompressionTypeCount,
+};
+
+void Compress(ThreadPool& pool, CompressionType type, float errorBound, const float* data, Uint64 count, std::vector<Uint8>& output);
+bool Decompress(ThreadPool& pool, const Uint8* data, Uint64 size, float* output, Uint64 count);
\ No newline at end of file
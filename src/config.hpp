@@ -2,5 +2,7 @@
 #define CONFIG_HPP
 
 #define THREADS 8
+#define TILE_SWEEPS 2
+#define BRICK_MAX_DILATION 3
 
 #endif
\ No newline at end of file
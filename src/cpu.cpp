@@ -0,0 +1,413 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu.hpp"
+#include "linsolve.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+static constexpr const char* PhaseNames[] =
+{
+    "None",
+    "Diffuse",
+    "Project",
+    "Advect",
+    "Bnd",
+};
+
+static int Index(int x, int y, int z, int size)
+{
+    return (z * size + y) * size + x;
+}
+
+static void Advect(
+    int x,
+    int y,
+    int z,
+    int size,
+    float* outImage,
+    const float* inImage,
+    const float* inVelocityX,
+    const float* inVelocityY,
+    const float* inVelocityZ,
+    float deltaTime)
+{
+    int id = Index(x, y, z, size);
+    float N = size - 2;
+    float dtx = deltaTime * N;
+    float dty = deltaTime * N;
+    float dtz = deltaTime * N;
+    float tmp1 = dtx * inVelocityX[id];
+    float tmp2 = dty * inVelocityY[id];
+    float tmp3 = dtz * inVelocityZ[id];
+    float fx = std::clamp(x - tmp1, 0.5f, N + 0.5f);
+    float fy = std::clamp(y - tmp2, 0.5f, N + 0.5f);
+    float fz = std::clamp(z - tmp3, 0.5f, N + 0.5f);
+    float i0 = std::floor(fx);
+    float j0 = std::floor(fy);
+    float k0 = std::floor(fz);
+    float s1 = fx - i0;
+    float s0 = 1.0f - s1;
+    float t1 = fy - j0;
+    float t0 = 1.0f - t1;
+    float u1 = fz - k0;
+    float u0 = 1.0f - u1;
+    int i0i = int(i0);
+    int i1i = i0i + 1;
+    int j0i = int(j0);
+    int j1i = j0i + 1;
+    int k0i = int(k0);
+    int k1i = k0i + 1;
+    outImage[id] =
+        s0 * (t0 * (u0 * inImage[Index(i0i, j0i, k0i, size)] +
+                    u1 * inImage[Index(i0i, j0i, k1i, size)]) +
+             (t1 * (u0 * inImage[Index(i0i, j1i, k0i, size)] +
+                    u1 * inImage[Index(i0i, j1i, k1i, size)]))) +
+        s1 * (t0 * (u0 * inImage[Index(i1i, j0i, k0i, size)] +
+                    u1 * inImage[Index(i1i, j0i, k1i, size)]) +
+             (t1 * (u0 * inImage[Index(i1i, j1i, k0i, size)] +
+                    u1 * inImage[Index(i1i, j1i, k1i, size)])));
+}
+
+void CpuTexture::Create(int size)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        Data[i].assign(size_t(size) * size * size, 0.0f);
+    }
+    ReadIndex = 0;
+}
+
+void CpuTexture::Swap()
+{
+    ReadIndex = (ReadIndex + 1) % 2;
+}
+
+float* CpuTexture::GetReadData()
+{
+    return Data[ReadIndex].data();
+}
+
+float* CpuTexture::GetWriteData()
+{
+    return Data[(ReadIndex + 1) % 2].data();
+}
+
+CpuSolver::CpuSolver()
+    : Speed{16.0f}
+    , Iterations{7}
+    , Diffusion{0.0000512f}
+    , Viscosity{0.000004f}
+    , Isa{GetBestLinSolveIsa()}
+    , LinSolve{GetLinSolveFunction(Isa)}
+    , Size{}
+    , Phase{CpuPhaseNone}
+    , PhaseStart{}
+    , PhaseTimes{}
+{
+}
+
+void CpuSolver::Create(int size, int threads)
+{
+    Size = size;
+    Pool.Create(threads);
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        Textures[i].Create(Size);
+    }
+    Scratch.assign(size_t(Size) * Size * Size, 0.0f);
+}
+
+void CpuSolver::Add1(TextureType texture, const int position[3], float value)
+{
+    if (std::any_of(position, position + 3, [this](int i) { return i < 0 || i >= Size; }))
+    {
+        return;
+    }
+    Textures[texture].GetReadData()[Index(position[0], position[1], position[2], Size)] += value;
+}
+
+float* CpuSolver::GetData(TextureType texture)
+{
+    return Textures[texture].GetReadData();
+}
+
+void CpuSolver::SetIsa(LinSolveIsa isa)
+{
+    Isa = IsLinSolveIsaSupported(isa) ? isa : LinSolveIsaScalar;
+    LinSolve = GetLinSolveFunction(Isa);
+}
+
+LinSolveIsa CpuSolver::GetIsa() const
+{
+    return Isa;
+}
+
+int CpuSolver::GetSize() const
+{
+    return Size;
+}
+
+int CpuSolver::GetThreads() const
+{
+    return Pool.GetThreads();
+}
+
+std::uint64_t CpuSolver::GetPhaseTime(CpuPhase phase) const
+{
+    return PhaseTimes[phase];
+}
+
+void CpuSolver::ResetPhaseTimes()
+{
+    std::fill(std::begin(PhaseTimes), std::end(PhaseTimes), 0);
+}
+
+CpuPhase CpuSolver::BeginPhase(CpuPhase phase)
+{
+    std::uint64_t time = SDL_GetTicksNS();
+    PhaseTimes[Phase] += time - PhaseStart;
+    CpuPhase previous = Phase;
+    Phase = phase;
+    PhaseStart = time;
+    return previous;
+}
+
+void CpuSolver::EndPhase(CpuPhase phase)
+{
+    BeginPhase(phase);
+}
+
+void CpuSolver::Diffuse1(CpuTexture& texture, float diffusion, int phase)
+{
+    float* inOutImage = texture.GetReadData();
+    const float* inSource = Scratch.data();
+    int N = Size;
+    float a = Speed * diffusion * (N - 2) * (N - 2);
+    float c = 1 + 6 * a;
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        LinSolve(inOutImage, inSource, Size, begin, end, phase, a, c);
+    });
+}
+
+void CpuSolver::Project1()
+{
+    const float* inVelocityX = Textures[TextureTypeVelocityX].GetReadData();
+    const float* inVelocityY = Textures[TextureTypeVelocityY].GetReadData();
+    const float* inVelocityZ = Textures[TextureTypeVelocityZ].GetReadData();
+    float* outPressure = Textures[TextureTypePressure].GetWriteData();
+    float* outDivergence = Textures[TextureTypeDivergence].GetWriteData();
+    int N = Size;
+    int stride = Size * Size;
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int y = 1; y < Size - 1; y++)
+        for (int x = 1; x < Size - 1; x++)
+        {
+            int id = Index(x, y, z, Size);
+            outDivergence[id] =
+                -0.5f * (inVelocityX[id + 1] -
+                         inVelocityX[id - 1] +
+                         inVelocityY[id + Size] -
+                         inVelocityY[id - Size] +
+                         inVelocityZ[id + stride] -
+                         inVelocityZ[id - stride]) / N;
+            outPressure[id] = 0.0f;
+        }
+    });
+    Textures[TextureTypePressure].Swap();
+    Textures[TextureTypeDivergence].Swap();
+}
+
+void CpuSolver::Project2(int phase)
+{
+    float* inOutPressure = Textures[TextureTypePressure].GetReadData();
+    const float* inDivergence = Textures[TextureTypeDivergence].GetReadData();
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        LinSolve(inOutPressure, inDivergence, Size, begin, end, phase, 1, 6);
+    });
+}
+
+void CpuSolver::Project3()
+{
+    const float* inPressure = Textures[TextureTypePressure].GetReadData();
+    const float* inVelocityX = Textures[TextureTypeVelocityX].GetReadData();
+    const float* inVelocityY = Textures[TextureTypeVelocityY].GetReadData();
+    const float* inVelocityZ = Textures[TextureTypeVelocityZ].GetReadData();
+    float* outVelocityX = Textures[TextureTypeVelocityX].GetWriteData();
+    float* outVelocityY = Textures[TextureTypeVelocityY].GetWriteData();
+    float* outVelocityZ = Textures[TextureTypeVelocityZ].GetWriteData();
+    int N = Size;
+    int stride = Size * Size;
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int y = 1; y < Size - 1; y++)
+        for (int x = 1; x < Size - 1; x++)
+        {
+            int id = Index(x, y, z, Size);
+            outVelocityX[id] = inVelocityX[id] - 0.5f * (inPressure[id + 1] - inPressure[id - 1]) * N;
+            outVelocityY[id] = inVelocityY[id] - 0.5f * (inPressure[id + Size] - inPressure[id - Size]) * N;
+            outVelocityZ[id] = inVelocityZ[id] - 0.5f * (inPressure[id + stride] - inPressure[id - stride]) * N;
+        }
+    });
+    Textures[TextureTypeVelocityX].Swap();
+    Textures[TextureTypeVelocityY].Swap();
+    Textures[TextureTypeVelocityZ].Swap();
+}
+
+void CpuSolver::Advect1(TextureType texture)
+{
+    CpuPhase previous = BeginPhase(CpuPhaseAdvect);
+    const float* inImage = Textures[texture].GetReadData();
+    const float* inVelocityX = Textures[TextureTypeVelocityX].GetReadData();
+    const float* inVelocityY = Textures[TextureTypeVelocityY].GetReadData();
+    const float* inVelocityZ = Textures[TextureTypeVelocityZ].GetReadData();
+    float* outVelocity = Textures[texture].GetWriteData();
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int y = 1; y < Size - 1; y++)
+        for (int x = 1; x < Size - 1; x++)
+        {
+            Advect(x, y, z, Size, outVelocity, inImage, inVelocityX, inVelocityY, inVelocityZ, Speed);
+        }
+    });
+    EndPhase(previous);
+}
+
+void CpuSolver::Advect2()
+{
+    CpuPhase previous = BeginPhase(CpuPhaseAdvect);
+    const float* inDensity = Textures[TextureTypeDensity].GetReadData();
+    const float* inVelocityX = Textures[TextureTypeVelocityX].GetReadData();
+    const float* inVelocityY = Textures[TextureTypeVelocityY].GetReadData();
+    const float* inVelocityZ = Textures[TextureTypeVelocityZ].GetReadData();
+    float* outDensity = Textures[TextureTypeDensity].GetWriteData();
+    Pool.For(1, Size - 1, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int y = 1; y < Size - 1; y++)
+        for (int x = 1; x < Size - 1; x++)
+        {
+            Advect(x, y, z, Size, outDensity, inDensity, inVelocityX, inVelocityY, inVelocityZ, Speed);
+        }
+    });
+    Textures[TextureTypeDensity].Swap();
+    EndPhase(previous);
+}
+
+void CpuSolver::Bnd(CpuTexture& texture, int type)
+{
+    CpuPhase previous = BeginPhase(CpuPhaseBnd);
+    float* image = texture.GetReadData();
+    int N = Size;
+    float signX = type == 1 ? -1.0f : 1.0f;
+    float signY = type == 2 ? -1.0f : 1.0f;
+    float signZ = type == 3 ? -1.0f : 1.0f;
+    Pool.For(0, N, [&](int begin, int end)
+    {
+        for (int y = begin; y < end; y++)
+        for (int x = 0; x < N; x++)
+        {
+            image[Index(x, y, 0, N)] = signZ * image[Index(x, y, 1, N)];
+            image[Index(x, y, N - 1, N)] = signZ * image[Index(x, y, N - 2, N)];
+        }
+    });
+    Pool.For(0, N, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int x = 0; x < N; x++)
+        {
+            image[Index(x, 0, z, N)] = signY * image[Index(x, 1, z, N)];
+            image[Index(x, N - 1, z, N)] = signY * image[Index(x, N - 2, z, N)];
+        }
+    });
+    Pool.For(0, N, [&](int begin, int end)
+    {
+        for (int z = begin; z < end; z++)
+        for (int y = 0; y < N; y++)
+        {
+            image[Index(0, y, z, N)] = signX * image[Index(1, y, z, N)];
+            image[Index(N - 1, y, z, N)] = signX * image[Index(N - 2, y, z, N)];
+        }
+    });
+    for (int i = 0; i < 8; i++)
+    {
+        int x = i & 4 ? N - 1 : 0;
+        int y = i & 1 ? N - 1 : 0;
+        int z = i & 2 ? N - 1 : 0;
+        int dx = x ? -1 : 1;
+        int dy = y ? -1 : 1;
+        int dz = z ? -1 : 1;
+        image[Index(x, y, z, N)] = 0.33f * (
+            image[Index(x + dx, y, z, N)] +
+            image[Index(x, y + dy, z, N)] +
+            image[Index(x, y, z + dz, N)]);
+    }
+    EndPhase(previous);
+}
+
+void CpuSolver::Project()
+{
+    CpuPhase previous = BeginPhase(CpuPhaseProject);
+    Project1();
+    Bnd(Textures[TextureTypeDivergence], 0);
+    Bnd(Textures[TextureTypePressure], 0);
+    for (int i = 0; i < Iterations; i++)
+    {
+        Project2(0);
+        Project2(1);
+        Bnd(Textures[TextureTypePressure], 0);
+    }
+    Project3();
+    Bnd(Textures[TextureTypeVelocityX], 1);
+    Bnd(Textures[TextureTypeVelocityY], 2);
+    Bnd(Textures[TextureTypeVelocityZ], 3);
+    EndPhase(previous);
+}
+
+void CpuSolver::Diffuse(CpuTexture& texture, float diffusion, int type)
+{
+    CpuPhase previous = BeginPhase(CpuPhaseDiffuse);
+    std::copy(texture.GetReadData(), texture.GetReadData() + Scratch.size(), Scratch.begin());
+    for (int i = 0; i < Iterations; i++)
+    {
+        Diffuse1(texture, diffusion, 0);
+        Diffuse1(texture, diffusion, 1);
+        Bnd(texture, type);
+    }
+    EndPhase(previous);
+}
+
+void CpuSolver::Update()
+{
+    Diffuse(Textures[TextureTypeVelocityX], Viscosity, 1);
+    Diffuse(Textures[TextureTypeVelocityY], Viscosity, 2);
+    Diffuse(Textures[TextureTypeVelocityZ], Viscosity, 3);
+    Project();
+    Advect1(TextureTypeVelocityX);
+    Advect1(TextureTypeVelocityY);
+    Advect1(TextureTypeVelocityZ);
+    Textures[TextureTypeVelocityX].Swap();
+    Textures[TextureTypeVelocityY].Swap();
+    Textures[TextureTypeVelocityZ].Swap();
+    Bnd(Textures[TextureTypeVelocityX], 1);
+    Bnd(Textures[TextureTypeVelocityY], 2);
+    Bnd(Textures[TextureTypeVelocityZ], 3);
+    Project();
+    Diffuse(Textures[TextureTypeDensity], Diffusion, 0);
+    Advect2();
+    Bnd(Textures[TextureTypeDensity], 0);
+}
+
+const char* GetCpuPhaseName(CpuPhase phase)
+{
+    return PhaseNames[phase];
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "linsolve.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+enum CpuPhase
+{
+    CpuPhaseNone,
+    CpuPhaseDiffuse,
+    CpuPhaseProject,
+    CpuPhaseAdvect,
+    CpuPhaseBnd,
+    CpuPhaseCount,
+};
+
+class CpuTexture
+{
+public:
+    CpuTexture() : ReadIndex{} {}
+    void Create(int size);
+    void Swap();
+    float* GetReadData();
+    float* GetWriteData();
+
+private:
+    std::vector<float> Data[2];
+    int ReadIndex;
+};
+
+class CpuSolver
+{
+public:
+    CpuSolver();
+    void Create(int size, int threads = 0);
+    void Add1(TextureType texture, const int position[3], float value);
+    void Update();
+    float* GetData(TextureType texture);
+    void SetIsa(LinSolveIsa isa);
+    LinSolveIsa GetIsa() const;
+    int GetSize() const;
+    int GetThreads() const;
+    std::uint64_t GetPhaseTime(CpuPhase phase) const;
+    void ResetPhaseTimes();
+
+    float Speed;
+    int Iterations;
+    float Diffusion;
+    float Viscosity;
+
+private:
+    void Diffuse1(CpuTexture& texture, float diffusion, int phase);
+    void Project1();
+    void Project2(int phase);
+    void Project3();
+    void Advect1(TextureType texture);
+    void Advect2();
+    void Bnd(CpuTexture& texture, int type);
+    void Project();
+    void Diffuse(CpuTexture& texture, float diffusion, int type);
+    CpuPhase BeginPhase(CpuPhase phase);
+    void EndPhase(CpuPhase phase);
+
+    LinSolveIsa Isa;
+    LinSolveFunction LinSolve;
+    ThreadPool Pool;
+    CpuTexture Textures[TextureTypeCount];
+    std::vector<float> Scratch;
+    int Size;
+    CpuPhase Phase;
+    std::uint64_t PhaseStart;
+    std::uint64_t PhaseTimes[CpuPhaseCount];
+};
+
+const char* GetCpuPhaseName(CpuPhase phase);
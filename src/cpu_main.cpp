@@ -0,0 +1,151 @@
+#include <SDL3/SDL.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "checkpoint.hpp"
+#include "cpu.hpp"
+#include "linsolve.hpp"
+#include "pool.hpp"
+#include "state.hpp"
+
+static int steps = 100;
+static int size = 128;
+static int threads;
+static State state;
+static CpuSolver solver;
+static CheckpointFile checkpoint;
+static bool restore;
+
+static bool ParseArgs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-' && IsCheckpoint(argv[i]))
+        {
+            if (!checkpoint.Open(argv[i]) || !checkpoint.GetState(state))
+            {
+                return false;
+            }
+            restore = true;
+            continue;
+        }
+        if (argv[i][0] != '-')
+        {
+            if (!LoadState(argv[i], state))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            SDL_Log("Missing value: %s", argv[i]);
+            return false;
+        }
+        if (!std::strcmp(argv[i], "--steps"))
+        {
+            steps = std::atoi(argv[++i]);
+        }
+        else if (!std::strcmp(argv[i], "--size"))
+        {
+            size = std::atoi(argv[++i]);
+        }
+        else if (!std::strcmp(argv[i], "--threads"))
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (!std::strcmp(argv[i], "--iterations"))
+        {
+            solver.Iterations = std::atoi(argv[++i]);
+        }
+        else if (!std::strcmp(argv[i], "--isa"))
+        {
+            const char* name = argv[++i];
+            LinSolveIsa isa = GetLinSolveIsa(name);
+            if (isa == LinSolveIsaCount || !IsLinSolveIsaSupported(isa))
+            {
+                SDL_Log("Unsupported isa: %s", name);
+                return false;
+            }
+            solver.SetIsa(isa);
+        }
+        else
+        {
+            SDL_Log("Unknown argument: %s", argv[i]);
+            return false;
+        }
+    }
+    if (restore)
+    {
+        const CheckpointHeader& header = checkpoint.GetHeader();
+        if (header.Size[0] != header.Size[1] || header.Size[0] != header.Size[2])
+        {
+            SDL_Log("Unsupported checkpoint size: %d, %d, %d", header.Size[0], header.Size[1], header.Size[2]);
+            return false;
+        }
+        size = header.Size[0];
+        solver.Speed = header.Speed;
+        solver.Diffusion = header.Diffusion;
+        solver.Viscosity = header.Viscosity;
+    }
+    if (steps <= 0 || size < 4)
+    {
+        SDL_Log("Invalid arguments: steps %d, size %d", steps, size);
+        return false;
+    }
+    return true;
+}
+
+static bool Restore()
+{
+    ThreadPool pool;
+    pool.Create(solver.GetThreads());
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        if (!checkpoint.ReadField(pool, TextureType(i), solver.GetData(TextureType(i))))
+        {
+            return false;
+        }
+    }
+    checkpoint.Close();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseArgs(argc, argv))
+    {
+        SDL_Log("Usage: %s [scene.json|checkpoint.ckpt] [--steps N] [--size N] [--threads N] [--iterations N] [--isa scalar|sse4|avx2|avx512]", argv[0]);
+        return 1;
+    }
+    solver.Create(size, threads);
+    if (restore)
+    {
+        if (!Restore())
+        {
+            return 1;
+        }
+    }
+    Uint64 time1 = SDL_GetTicksNS();
+    for (int i = 0; i < steps; i++)
+    {
+        for (const Spawner& spawner : state.Spawners)
+        {
+            if (!spawner.Enabled)
+            {
+                continue;
+            }
+            solver.Add1(spawner.Texture, spawner.Position.data(), spawner.Value);
+        }
+        solver.Update();
+    }
+    Uint64 time2 = SDL_GetTicksNS();
+    double seconds = double(time2 - time1) / SDL_NS_PER_SECOND;
+    double cells = double(size) * size * size * steps;
+    SDL_Log("Size: %d, Threads: %d, Iterations: %d, Isa: %s", size, solver.GetThreads(), solver.Iterations,
+        GetLinSolveIsaName(solver.GetIsa()));
+    SDL_Log("Steps: %d, Time: %.3f s, Step: %.3f ms", steps, seconds, seconds * 1000.0 / steps);
+    SDL_Log("Throughput: %.3e cells/s", cells / seconds);
+    return 0;
+}
@@ -11,19 +11,37 @@
 #include <string>
 
 #include "helpers.hpp"
+#include "profiler.hpp"
+
+static Profiler* profiler;
 
 DebugGroupClass::DebugGroupClass(SDL_GPUCommandBuffer* commandBuffer, const char* name)
     : CommandBuffer{commandBuffer}
+    , Name{name}
+    , Begin{}
 {
     SDL_PushGPUDebugGroup(CommandBuffer, name);
+    if (profiler)
+    {
+        Begin = profiler->Begin();
+    }
 }
 
 DebugGroupClass::~DebugGroupClass()
 {
+    if (profiler)
+    {
+        profiler->End(Name, Begin);
+    }
     SDL_PopGPUDebugGroup(CommandBuffer);
 }
 
-static void* Load(SDL_GPUDevice* device, const char* name)
+void SetDebugGroupProfiler(Profiler* value)
+{
+    profiler = value;
+}
+
+static void* Load(SDL_GPUDevice* device, const char* name, SDL_GPUComputePipelineCreateInfo* reflection)
 {
     SDL_GPUShaderFormat shaderFormat = SDL_GetGPUShaderFormats(device);
     const char* entrypoint;
@@ -95,6 +113,12 @@ static void* Load(SDL_GPUDevice* device, const char* name)
         info.entrypoint = entrypoint;
         info.format = shaderFormat;
         shader = SDL_CreateGPUComputePipeline(device, &info);
+        if (reflection)
+        {
+            *reflection = info;
+            reflection->code = nullptr;
+            reflection->code_size = 0;
+        }
     }
     else
     {
@@ -127,10 +151,10 @@ static void* Load(SDL_GPUDevice* device, const char* name)
 
 SDL_GPUShader* LoadShader(SDL_GPUDevice* device, const char* name)
 {
-    return static_cast<SDL_GPUShader*>(Load(device, name));
+    return static_cast<SDL_GPUShader*>(Load(device, name, nullptr));
 }
 
-SDL_GPUComputePipeline* LoadComputePipeline(SDL_GPUDevice* device, const char* name)
+SDL_GPUComputePipeline* LoadComputePipeline(SDL_GPUDevice* device, const char* name, SDL_GPUComputePipelineCreateInfo* reflection)
 {
-    return static_cast<SDL_GPUComputePipeline*>(Load(device, name));
+    return static_cast<SDL_GPUComputePipeline*>(Load(device, name, reflection));
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <SDL3/SDL.h>
 
+#include "profiler.hpp"
+
 #define DebugGroup(commandBuffer) DebugGroupClass debugGroup(commandBuffer, SDL_FUNCTION)
 #define DebugGroupBlock(commandBuffer, name) DebugGroupClass debugGroup(commandBuffer, name)
 
@@ -13,7 +15,10 @@ public:
 
 private:
     SDL_GPUCommandBuffer* CommandBuffer;
+    const char* Name;
+    Uint64 Begin;
 };
 
+void SetDebugGroupProfiler(Profiler* profiler);
 SDL_GPUShader* LoadShader(SDL_GPUDevice* device, const char* name);
-SDL_GPUComputePipeline* LoadComputePipeline(SDL_GPUDevice* device, const char* name);
\ No newline at end of file
+SDL_GPUComputePipeline* LoadComputePipeline(SDL_GPUDevice* device, const char* name, SDL_GPUComputePipelineCreateInfo* reflection = nullptr);
\ No newline at end of file
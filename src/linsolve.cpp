@@ -0,0 +1,104 @@
+#include <SDL3/SDL.h>
+
+#include <cstring>
+
+#include "linsolve.hpp"
+
+static constexpr const char* Names[] =
+{
+    "scalar",
+    "sse4",
+    "avx2",
+    "avx512",
+};
+
+static_assert(SDL_arraysize(Names) == LinSolveIsaCount);
+
+void LinSolveScalar(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c)
+{
+    int stride = size * size;
+    for (int z = zBegin; z < zEnd; z++)
+    for (int y = 1; y < size - 1; y++)
+    {
+        int row = z * stride + y * size;
+        for (int x = 2 - ((y + z + phase) & 1); x < size - 1; x += 2)
+        {
+            int id = row + x;
+            outImage[id] =
+                (inImage[id] +
+                    a * (outImage[id + 1] +
+                         outImage[id - 1] +
+                         outImage[id + size] +
+                         outImage[id - size] +
+                         outImage[id + stride] +
+                         outImage[id - stride])) / c;
+        }
+    }
+}
+
+bool IsLinSolveIsaSupported(LinSolveIsa isa)
+{
+    switch (isa)
+    {
+    case LinSolveIsaScalar:
+        return true;
+#ifdef LINSOLVE_X86
+    case LinSolveIsaSse4:
+        return SDL_HasSSE41();
+    case LinSolveIsaAvx2:
+        return SDL_HasAVX2();
+    case LinSolveIsaAvx512:
+        return SDL_HasAVX512F();
+#endif
+    default:
+        return false;
+    }
+}
+
+LinSolveIsa GetBestLinSolveIsa()
+{
+    for (int i = LinSolveIsaCount - 1; i > LinSolveIsaScalar; i--)
+    {
+        if (IsLinSolveIsaSupported(LinSolveIsa(i)))
+        {
+            return LinSolveIsa(i);
+        }
+    }
+    return LinSolveIsaScalar;
+}
+
+LinSolveFunction GetLinSolveFunction(LinSolveIsa isa)
+{
+    if (!IsLinSolveIsaSupported(isa))
+    {
+        return LinSolveScalar;
+    }
+    switch (isa)
+    {
+#ifdef LINSOLVE_X86
+    case LinSolveIsaSse4:
+        return LinSolveSse4;
+    case LinSolveIsaAvx2:
+        return LinSolveAvx2;
+    case LinSolveIsaAvx512:
+        return LinSolveAvx512;
+#endif
+    default:
+        return LinSolveScalar;
+    }
+}
+
+const char* GetLinSolveIsaName(LinSolveIsa isa)
+{
+    return Names[isa];
+}
+
+LinSolveIsa GetLinSolveIsa(const char* name)
+{
+    int isa = 0;
+    while (isa < LinSolveIsaCount && std::strcmp(name, Names[isa]))
+    {
+        isa++;
+    }
+    return LinSolveIsa(isa);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LINSOLVE_X86
+#endif
+
+enum LinSolveIsa
+{
+    LinSolveIsaScalar,
+    LinSolveIsaSse4,
+    LinSolveIsaAvx2,
+    LinSolveIsaAvx512,
+    LinSolveIsaCount,
+};
+
+// Each kernel relaxes the cells of one color for slabs [zBegin, zEnd). The vector kernels compute whole
+// rows and store one chunk behind so the x - 1 load never waits on the previous store. Rows that a
+// neighbouring slab reads only get that color written, since writing back the other one races its loads
+using LinSolveFunction = void(*)(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c);
+
+void LinSolveScalar(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c);
+#ifdef LINSOLVE_X86
+void LinSolveSse4(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c);
+void LinSolveAvx2(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c);
+void LinSolveAvx512(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c);
+#endif
+
+bool IsLinSolveIsaSupported(LinSolveIsa isa);
+LinSolveIsa GetBestLinSolveIsa();
+LinSolveFunction GetLinSolveFunction(LinSolveIsa isa);
+const char* GetLinSolveIsaName(LinSolveIsa isa);
+LinSolveIsa GetLinSolveIsa(const char* name);
@@ -0,0 +1,54 @@
+#include "linsolve.hpp"
+
+#ifdef LINSOLVE_X86
+#include <immintrin.h>
+
+void LinSolveAvx2(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c)
+{
+    int stride = size * size;
+    __m256 va = _mm256_set1_ps(a);
+    __m256 vc = _mm256_set1_ps(c);
+    __m256i even = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    __m256i odd = _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    for (int z = zBegin; z < zEnd; z++)
+    for (int y = 1; y < size - 1; y++)
+    {
+        int row = z * stride + y * size;
+        int parity = (y + z + phase) & 1;
+        __m256i mask = parity ? even : odd;
+        __m256 previous;
+        int x = 1;
+        for (; x + 8 <= size - 1; x += 8)
+        {
+            int id = row + x;
+            __m256 sum = _mm256_add_ps(_mm256_loadu_ps(outImage + id + 1), _mm256_loadu_ps(outImage + id - 1));
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(outImage + id + size));
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(outImage + id - size));
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(outImage + id + stride));
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(outImage + id - stride));
+            __m256 value = _mm256_div_ps(_mm256_add_ps(_mm256_loadu_ps(inImage + id), _mm256_mul_ps(va, sum)), vc);
+            if (x > 1)
+            {
+                _mm256_maskstore_ps(outImage + id - 8, mask, previous);
+            }
+            previous = value;
+        }
+        if (x > 1)
+        {
+            _mm256_maskstore_ps(outImage + row + x - 8, mask, previous);
+        }
+        for (x += (x & 1) != parity; x < size - 1; x += 2)
+        {
+            int id = row + x;
+            outImage[id] =
+                (inImage[id] +
+                    a * (outImage[id + 1] +
+                         outImage[id - 1] +
+                         outImage[id + size] +
+                         outImage[id - size] +
+                         outImage[id + stride] +
+                         outImage[id - stride])) / c;
+        }
+    }
+}
+#endif
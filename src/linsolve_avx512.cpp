@@ -0,0 +1,39 @@
+#include <algorithm>
+
+#include "linsolve.hpp"
+
+#ifdef LINSOLVE_X86
+#include <immintrin.h>
+
+void LinSolveAvx512(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c)
+{
+    int stride = size * size;
+    __m512 va = _mm512_set1_ps(a);
+    __m512 vc = _mm512_set1_ps(c);
+    for (int z = zBegin; z < zEnd; z++)
+    for (int y = 1; y < size - 1; y++)
+    {
+        int row = z * stride + y * size;
+        __mmask16 active = (y + z + phase) & 1 ? 0x5555 : 0xAAAA;
+        __mmask16 previousMask = 0;
+        __m512 previous = _mm512_setzero_ps();
+        int x = 1;
+        for (; x < size - 1; x += 16)
+        {
+            int id = row + x;
+            int count = std::min(16, size - 1 - x);
+            __mmask16 tail = __mmask16((1u << count) - 1);
+            __m512 sum = _mm512_add_ps(_mm512_maskz_loadu_ps(tail, outImage + id + 1), _mm512_maskz_loadu_ps(tail, outImage + id - 1));
+            sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(tail, outImage + id + size));
+            sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(tail, outImage + id - size));
+            sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(tail, outImage + id + stride));
+            sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(tail, outImage + id - stride));
+            __m512 value = _mm512_div_ps(_mm512_add_ps(_mm512_maskz_loadu_ps(tail, inImage + id), _mm512_mul_ps(va, sum)), vc);
+            _mm512_mask_storeu_ps(outImage + id - 16, previousMask, previous);
+            previous = value;
+            previousMask = active & tail;
+        }
+        _mm512_mask_storeu_ps(outImage + row + x - 16, previousMask, previous);
+    }
+}
+#endif
@@ -0,0 +1,79 @@
+#include "linsolve.hpp"
+
+#ifdef LINSOLVE_X86
+#include <smmintrin.h>
+
+// Stores only the cells of the color being relaxed, for rows another thread's slab reads
+static void StoreColor(float* output, __m128 value, int parity)
+{
+    if (parity)
+    {
+        _mm_store_ss(output, value);
+        _mm_store_ss(output + 2, _mm_movehl_ps(value, value));
+    }
+    else
+    {
+        _mm_store_ss(output + 1, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)));
+        _mm_store_ss(output + 3, _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+}
+
+void LinSolveSse4(float* outImage, const float* inImage, int size, int zBegin, int zEnd, int phase, float a, float c)
+{
+    int stride = size * size;
+    __m128 va = _mm_set1_ps(a);
+    __m128 vc = _mm_set1_ps(c);
+    __m128 even = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0));
+    __m128 odd = _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+    for (int z = zBegin; z < zEnd; z++)
+    for (int y = 1; y < size - 1; y++)
+    {
+        int row = z * stride + y * size;
+        int parity = (y + z + phase) & 1;
+        bool shared = z == zBegin || z == zEnd - 1;
+        __m128 mask = parity ? even : odd;
+        __m128 previous;
+        int x = 1;
+        for (; x + 4 <= size - 1; x += 4)
+        {
+            int id = row + x;
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(outImage + id + 1), _mm_loadu_ps(outImage + id - 1));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(outImage + id + size));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(outImage + id - size));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(outImage + id + stride));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(outImage + id - stride));
+            __m128 value = _mm_div_ps(_mm_add_ps(_mm_loadu_ps(inImage + id), _mm_mul_ps(va, sum)), vc);
+            value = _mm_blendv_ps(_mm_loadu_ps(outImage + id), value, mask);
+            if (x > 1 && shared)
+            {
+                StoreColor(outImage + id - 4, previous, parity);
+            }
+            else if (x > 1)
+            {
+                _mm_storeu_ps(outImage + id - 4, previous);
+            }
+            previous = value;
+        }
+        if (x > 1 && shared)
+        {
+            StoreColor(outImage + row + x - 4, previous, parity);
+        }
+        else if (x > 1)
+        {
+            _mm_storeu_ps(outImage + row + x - 4, previous);
+        }
+        for (x += (x & 1) != parity; x < size - 1; x += 2)
+        {
+            int id = row + x;
+            outImage[id] =
+                (inImage[id] +
+                    a * (outImage[id + 1] +
+                         outImage[id - 1] +
+                         outImage[id + size] +
+                         outImage[id - size] +
+                         outImage[id + stride] +
+                         outImage[id - stride])) / c;
+        }
+    }
+}
+#endif
@@ -9,32 +9,33 @@
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <filesystem>
 #include <exception>
 #include <format>
 #include <fstream>
-#include <mutex>
+#include <functional>
+#include <optional>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#include "checkpoint.hpp"
+#include "compress.hpp"
 #include "config.hpp"
 #include "helpers.hpp"
+#include "pool.hpp"
+#include "profiler.hpp"
+#include "queue.hpp"
+#include "recorder.hpp"
+#include "state.hpp"
 #include "texture.hpp"
 
-enum TextureType
-{
-    TextureTypeVelocityX,
-    TextureTypeVelocityY,
-    TextureTypeVelocityZ,
-    TextureTypePressure,
-    TextureTypeDivergence,
-    TextureTypeDensity,
-    TextureTypeCount,
-};
-
 static constexpr const char* Textures[] =
 {
     "Velocity (X)",
@@ -46,28 +47,39 @@ static constexpr const char* Textures[] =
     "Combined",
 };
 
-static constexpr TextureType Spawners[] =
+static constexpr const char* PressureSolvers[] =
 {
-    TextureTypeVelocityX,
-    TextureTypeVelocityY,
-    TextureTypeVelocityZ,
-    TextureTypeDensity
+    "Red-Black",
+    "Multigrid",
 };
 
-struct Spawner
+static constexpr const char* Compressions[] =
 {
-    TextureType Texture;
-    int Position[3];
-    float Value;
+    "None",
+    "Lossless",
+    "Quantized",
+};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Spawner, Texture, Position, Value)
+static constexpr const char* ProfilerThreads[] =
+{
+    "Render",
+    "Simulation",
 };
 
-struct State
+static constexpr const char* Solves[] =
 {
-    std::vector<Spawner> Spawners;
+    "Diffuse (Velocity)",
+    "Project (1)",
+    "Project (2)",
+    "Diffuse (Density)",
+};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(State, Spawners)
+static constexpr TextureType Spawners[] =
+{
+    TextureTypeVelocityX,
+    TextureTypeVelocityY,
+    TextureTypeVelocityZ,
+    TextureTypeDensity
 };
 
 struct RaymarchUniformBuffer
@@ -80,6 +92,12 @@ struct RaymarchUniformBuffer
     float Padding[3];
 };
 
+struct OccupancyUniformBuffer
+{
+    float Threshold;
+    float DeltaTime;
+};
+
 struct BrushUniformBuffer
 {
     glm::vec3 Position;
@@ -88,35 +106,221 @@ struct BrushUniformBuffer
     float Dye;
 };
 
+struct SpawnerStorageBuffer
+{
+    glm::ivec3 Position;
+    Uint32 Texture;
+    float Value;
+    Uint32 Padding[3];
+};
+
+enum PressureSolver
+{
+    PressureSolverRedBlack,
+    PressureSolverMultigrid,
+};
+
+enum SolverMode
+{
+    SolverModeReset,
+    SolverModeCheck,
+    SolverModeStore,
+};
+
+enum ResidualFlags
+{
+    ResidualFlagWrite = 1,
+    ResidualFlagReduce = 2,
+};
+
+enum BrickMode
+{
+    BrickModeReset,
+    BrickModeCompact,
+    BrickModeFill,
+    BrickModeMark,
+    BrickModeArguments,
+};
+
+enum SolveType
+{
+    SolveTypeVelocity,
+    SolveTypeProject1,
+    SolveTypeProject2,
+    SolveTypeDensity,
+    SolveTypeCount,
+};
+
+struct MultigridLevel
+{
+    ReadWriteTexture Pressure;
+    ReadWriteTexture Rhs;
+    ReadWriteTexture Residual;
+    SDL_GPUBuffer* Bricks;
+};
+
+struct SimulationSettings
+{
+    float Speed = 16.0f;
+    int Iterations = 7;
+    float Diffusion = 0.0000512f;
+    float Viscosity = 0.000004f;
+    int PressureSolver = PressureSolverRedBlack;
+    bool Tiled = false;
+    bool Sparse = false;
+    float SparseThreshold = 0.0001f;
+    bool Interpolate = false;
+    bool Adaptive = false;
+    int CheckInterval = 2;
+    float DiffuseTolerance = 0.0001f;
+    float PressureTolerance = 0.00001f;
+    int MaxCycles = 8;
+    int StepRate = 60;
+    int MaxSubsteps = 4;
+    int RecordInterval = 1;
+    int Compression = CompressionTypeNone;
+    float ErrorBound = 0.0001f;
+
+    bool operator==(const SimulationSettings& other) const = default;
+};
+
+struct Frame
+{
+    glm::ivec3 Size;
+    SDL_GPUTexture* Textures[TextureTypeCount];
+    SDL_GPUTexture* Previous;
+    std::optional<State> Scene;
+    std::optional<CheckpointHeader> Checkpoint;
+    std::atomic<Uint64> Steps;
+    std::atomic<Uint64> Time;
+    std::atomic<bool> Interpolated;
+    std::atomic<std::vector<TimelineEvent>*> SpawnerEvents;
+};
+
+enum CommandType
+{
+    CommandTypeSettings,
+    CommandTypeSpawners,
+    CommandTypeBrush,
+    CommandTypeReset,
+    CommandTypeLoad,
+    CommandTypeSave,
+    CommandTypeCheckpoint,
+    CommandTypeRestore,
+    CommandTypeRecord,
+    CommandTypeStop,
+    CommandTypeRoofline,
+    CommandTypePhases,
+};
+
+struct Command
+{
+    CommandType Type;
+    SimulationSettings Settings;
+    State Scene;
+    std::string Path;
+    BrushUniformBuffer Brush;
+};
+
 enum PipelineType
 {
-    PipelineTypeAdd1,
     PipelineTypeClear,
     PipelineTypeDiffuse,
+    PipelineTypeDiffuse3,
+    PipelineTypeDiffuseTiled,
     PipelineTypeProject1,
     PipelineTypeProject2,
+    PipelineTypeProject2Tiled,
     PipelineTypeProject3,
     PipelineTypeAdvect1,
     PipelineTypeAdvect2,
-    PipelineTypeBnd1,
-    PipelineTypeBnd2,
-    PipelineTypeBnd3,
-    PipelineTypeBnd4,
-    PipelineTypeBnd5,
+    PipelineTypeBnd,
     PipelineTypeBrush,
     PipelineTypeRaymarch,
+    PipelineTypeResidual,
+    PipelineTypeRestrict,
+    PipelineTypeProlong,
+    PipelineTypeSolver,
+    PipelineTypeSpawn,
+    PipelineTypeOccupancy,
+    PipelineTypeCompact,
+    PipelineTypeClearBricks,
+    PipelineTypeMacrocell,
+    PipelineTypePack,
+    PipelineTypeInterpolate,
     PipelineTypeCount,
 };
 
-static constexpr int kSize = 128;
+struct Traffic
+{
+    float Reads;
+    float Writes;
+    float Flops;
+};
+
+struct DispatchTraffic
+{
+    double ReadBytes;
+    double WriteBytes;
+    double Flops;
+};
+
+struct RooflineResult
+{
+    const char* Name;
+    double Ms;
+    DispatchTraffic Traffic;
+};
+
+// Values read, values written and flops per thread, from the shader source
+static constexpr Traffic kTraffic[PipelineTypeCount] =
+{
+    {0.0f, 1.0f, 0.0f},
+    {7.0f, 1.0f, 9.0f},
+    {21.0f, 3.0f, 27.0f},
+    {2.0f, 1.0f, 9.0f * TILE_SWEEPS},
+    {6.0f, 2.0f, 8.0f},
+    {7.0f, 1.0f, 8.0f},
+    {2.0f, 1.0f, 8.0f * TILE_SWEEPS},
+    {9.0f, 3.0f, 12.0f},
+    {27.0f, 3.0f, 90.0f},
+    {11.0f, 1.0f, 47.0f},
+    {1.0f, 1.0f, 1.0f},
+    {4.0f, 4.0f, 20.0f},
+    {0.0f, 0.0f, 0.0f},
+    {8.0f, 1.0f, 10.0f},
+    {8.0f, 2.0f, 10.0f},
+    {2.0f, 1.0f, 1.0f},
+    {0.0f, 0.0f, 0.0f},
+    {1.0f, 1.0f, 1.0f},
+    {4.0f, 0.0f, 8.0f},
+    {0.0f, 0.0f, 0.0f},
+    {0.0f, 6.0f, 0.0f},
+    {6.0f, 0.0f, 8.0f},
+    {4.0f, 4.0f, 12.0f},
+    {2.0f, 1.0f, 3.0f},
+};
+
 static constexpr float kWidth = 480.0f;
 static constexpr float kZoom = 20.0f;
 static constexpr float kPan = 0.005f;
 static constexpr float kFov = glm::radians(60.0f);
 static constexpr float kNear = 0.1f;
 static constexpr float kFar = 1000.0f;
-static constexpr float kCooldown = 16.0f;
+static constexpr Uint64 kRealTimeWindow = SDL_NS_PER_SECOND;
 static constexpr float kEpsilon = 0.0001f;
+static constexpr int kMaxLevels = 8;
+static constexpr int kRooflineRepeats = 16;
+static constexpr int kMinLevelSize = 4;
+static constexpr int kSmoothSweeps = 2;
+static constexpr int kCoarseSweeps = 16;
+static constexpr int kSolverSolves = 4;
+static constexpr int kSolverSize = (kSolverSolves + 2 * SolveTypeCount) * sizeof(Uint32);
+static constexpr int kBrickArguments = 0;
+static constexpr int kBrickList = 4;
+static constexpr int kCommandCapacity = 64;
+static constexpr int kFrameCapacity = 8;
+static constexpr Uint64 kIdleDelay = SDL_NS_PER_MS;
 
 static SDL_Window* window;
 static SDL_GPUDevice* device;
@@ -127,12 +331,53 @@ static uint32_t colorHeight;
 static uint32_t swapchainWidth;
 static uint32_t swapchainHeight;
 static ReadWriteTexture textures[TextureTypeCount];
-static SDL_GPUTexture* scratchTexture;
+static SDL_GPUTexture* scratchTextures[3];
+static SDL_GPUTexture* renderTexture;
+static SDL_GPUTexture* interpolatedTexture;
+static glm::ivec3 gridSize;
+static glm::ivec3 newGridSize;
 static SDL_GPUSampler* sampler;
-static float speed = 16.0f;
-static int iterations = 7;
-static float diffusion = 0.0000512f;
-static float viscosity = 0.000004f;
+static SDL_GPUBuffer* solverBuffer;
+static SDL_GPUTransferBuffer* solverTransferBuffer;
+static SDL_GPUFence* stepFence;
+static SDL_GPUComputePipelineCreateInfo reflections[PipelineTypeCount];
+static thread_local PipelineType boundPipeline;
+static thread_local DispatchTraffic dispatchTraffic;
+static std::atomic<std::vector<RooflineResult>*> rooflineReport;
+static std::atomic<std::vector<RooflineResult>*> phaseReport;
+static std::vector<RooflineResult> rooflineResults;
+static Uint64 stepTime;
+static SDL_GPUFence* renderFence;
+static Uint64 renderTime;
+static SDL_GPUTransferBuffer* checkpointTransferBuffer;
+static Uint32 checkpointTransferSize;
+static SDL_GPUFence* checkpointFence;
+static std::string checkpointFile;
+static CheckpointHeader checkpointHeader;
+static State checkpointState;
+static std::atomic<Uint32> solveIterations[SolveTypeCount];
+static std::atomic<float> solveResiduals[SolveTypeCount];
+static SDL_GPUBuffer* spawnerBuffer;
+static SDL_GPUTransferBuffer* spawnerTransferBuffer;
+static Uint32 spawnerCapacity;
+static Uint32 spawnerCount;
+static bool spawnersDirty = true;
+static std::vector<Spawner> simulationSpawners;
+static std::vector<TimelineEvent> simulationTimeline;
+static int timelineIndex;
+static MultigridLevel levels[kMaxLevels];
+static int levelCount;
+static SDL_GPUBuffer* occupancyBuffer;
+static SDL_GPUBuffer* activeBricksBuffer;
+static SDL_GPUBuffer* clearBricksBuffer;
+static SDL_GPUBuffer* macrocellBuffer;
+static bool renderDirty = true;
+static int renderType;
+static float renderDyeStrength;
+static bool sparseReset = true;
+static SimulationSettings settings;
+static SimulationSettings newSettings;
+static SimulationSettings sentSettings;
 static float dyeStrength = 2.0f;
 static float brushRadius = 8.0f;
 static float brushStrength = 0.5f;
@@ -140,9 +385,19 @@ static float brushDye = 1.0f;
 static bool brushActive;
 static glm::vec3 brushPosition;
 static glm::vec3 brushVelocity;
-static int cooldown;
-static uint64_t time1;
-static uint64_t time2;
+static bool brushPending;
+static BrushUniformBuffer brush;
+static Uint64 accumulator;
+static Uint64 simulationSteps;
+static Recorder recorder;
+static ThreadPool compressionPool;
+static Profiler profiler;
+static bool profiling;
+static Uint64 realTimeWall;
+static Uint64 realTimeSimulated;
+static Uint64 realTimeSteps;
+static std::atomic<float> realTimeFactor;
+static std::atomic<float> stepsPerSecond;
 static float pitch;
 static float yaw;
 static float distance = 200.0f;
@@ -155,7 +410,201 @@ static glm::mat4 inverseProj;
 static glm::mat4 viewProj;
 static int texture = TextureTypeCount;
 static State state;
-static std::mutex mutex;
+static bool spawnersChanged;
+static SpscQueue<Command, kCommandCapacity> commands;
+static SpscQueue<Frame*, kFrameCapacity> frames;
+static Frame* simulationFrame;
+static Frame* renderFrame;
+static Uint64 renderSteps;
+static std::atomic<std::string*> savePath;
+static std::atomic<std::string*> loadPath;
+static std::atomic<std::string*> checkpointPath;
+static std::atomic<std::string*> recordPath;
+static std::atomic<std::string*> tracePath;
+static std::string traceFile;
+static int traceFrames = 120;
+static std::string scenePath;
+static std::string outputPath;
+static bool outputCheckpoint = true;
+static State overrides{.Size = {}};
+static bool headless;
+static std::atomic<Uint64> maxSteps;
+static Uint64 headlessTime;
+static Uint64 headlessSteps;
+static double headlessSeconds;
+static Uint64 warmupSteps;
+static bool phasesSent;
+static std::atomic<bool> simulating;
+static std::thread simulationThread;
+
+static bool ParseArgs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            scenePath = argv[i];
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--headless"))
+        {
+            headless = true;
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--multigrid"))
+        {
+            newSettings.PressureSolver = PressureSolverMultigrid;
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--adaptive"))
+        {
+            newSettings.Adaptive = true;
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--tiled"))
+        {
+            newSettings.Tiled = true;
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--sparse"))
+        {
+            newSettings.Sparse = true;
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--no-checkpoint"))
+        {
+            outputCheckpoint = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            SDL_Log("Missing value: %s", argv[i]);
+            return false;
+        }
+        const char* value = argv[++i];
+        if (!std::strcmp(argv[i - 1], "--trace"))
+        {
+            traceFile = value;
+        }
+        else if (!std::strcmp(argv[i - 1], "--steps"))
+        {
+            overrides.Steps = std::atoi(value);
+            maxSteps = std::max(overrides.Steps, 0);
+        }
+        else if (!std::strcmp(argv[i - 1], "--warmup"))
+        {
+            warmupSteps = std::strtoull(value, nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i - 1], "--size"))
+        {
+            int size = std::atoi(value);
+            overrides.Size = {size, size, size};
+        }
+        else if (!std::strcmp(argv[i - 1], "--iterations"))
+        {
+            overrides.Iterations = std::atoi(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--viscosity"))
+        {
+            overrides.Viscosity = std::atof(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--diffusion"))
+        {
+            overrides.Diffusion = std::atof(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--dt"))
+        {
+            overrides.DeltaTime = std::atof(value);
+        }
+        else if (!std::strcmp(argv[i - 1], "--output"))
+        {
+            outputPath = value;
+        }
+        else if (!std::strcmp(argv[i - 1], "--timeline"))
+        {
+            if (!LoadTimeline(value, overrides.Timeline))
+            {
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i - 1], "--trace-frames"))
+        {
+            traceFrames = std::atoi(value);
+        }
+        else
+        {
+            SDL_Log("Unknown argument: %s", argv[i - 1]);
+            return false;
+        }
+    }
+    if (traceFrames <= 0 || overrides.Size[0] < 0 || (overrides.Size[0] > 0 && overrides.Size[0] < 4))
+    {
+        SDL_Log("Invalid arguments: trace frames %d, size %d", traceFrames, overrides.Size[0]);
+        return false;
+    }
+    return true;
+}
+
+static void ApplyParameters(const State& scene, SimulationSettings& target)
+{
+    const State* sources[] = {&scene, &overrides};
+    for (const State* source : sources)
+    {
+        if (source->Iterations > 0)
+        {
+            target.Iterations = source->Iterations;
+        }
+        if (source->DeltaTime > 0.0f)
+        {
+            target.Speed = source->DeltaTime;
+        }
+        if (source->Diffusion >= 0.0f)
+        {
+            target.Diffusion = source->Diffusion;
+        }
+        if (source->Viscosity >= 0.0f)
+        {
+            target.Viscosity = source->Viscosity;
+        }
+    }
+}
+
+static bool WriteOutput(double seconds, Uint64 steps, const std::vector<RooflineResult>& phases)
+{
+    State scene = state;
+    scene.Steps = renderSteps;
+    scene.Iterations = newSettings.Iterations;
+    scene.DeltaTime = newSettings.Speed;
+    scene.Diffusion = newSettings.Diffusion;
+    scene.Viscosity = newSettings.Viscosity;
+    std::filesystem::path directory = outputPath;
+    if (!SaveState((directory / "scene.json").string().data(), scene))
+    {
+        return false;
+    }
+    nlohmann::ordered_json report;
+    report["Scene"] = scenePath;
+    report["Size"] = scene.Size;
+    report["Warmup"] = renderSteps - steps;
+    report["Steps"] = steps;
+    report["Seconds"] = seconds;
+    report["StepsPerSecond"] = steps / seconds;
+    nlohmann::ordered_json phaseMs = nlohmann::ordered_json::object();
+    for (const RooflineResult& phase : phases)
+    {
+        phaseMs[phase.Name] = phase.Ms;
+    }
+    report["PhaseMs"] = phaseMs;
+    std::string path = (directory / "run.json").string();
+    std::ofstream file(path);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path.data());
+        return false;
+    }
+    file << report.dump(4);
+    return true;
+}
 
 static bool Init()
 {
@@ -163,16 +612,23 @@ static bool Init()
     SDL_SetLogPriorities(SDL_LOG_PRIORITY_VERBOSE);
 #endif
     SDL_SetAppMetadata("Fluid Simulation", nullptr, nullptr);
+    if (headless)
+    {
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
         SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
         return false;
     }
-    window = SDL_CreateWindow("Fluid Simulation", 960, 720, SDL_WINDOW_RESIZABLE);
-    if (!window)
+    if (!headless)
     {
-        SDL_Log("Failed to create window: %s", SDL_GetError());
-        return false;
+        window = SDL_CreateWindow("Fluid Simulation", 960, 720, SDL_WINDOW_RESIZABLE);
+        if (!window)
+        {
+            SDL_Log("Failed to create window: %s", SDL_GetError());
+            return false;
+        }
     }
 #ifndef NDEBUG
     device = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_SPIRV | SDL_GPU_SHADERFORMAT_MSL, true, nullptr);
@@ -184,6 +640,11 @@ static bool Init()
         SDL_Log("Failed to create device: %s", SDL_GetError());
         return false;
     }
+    SetDebugGroupProfiler(&profiler);
+    if (headless)
+    {
+        return true;
+    }
     if (!SDL_ClaimWindowForGPUDevice(device, window))
     {
         SDL_Log("Failed to create swapchain: %s", SDL_GetError());
@@ -219,21 +680,30 @@ static bool CreateSamplers()
 
 static bool CreatePipelines()
 {
-    pipelines[PipelineTypeAdd1] = LoadComputePipeline(device, "add1.comp");
-    pipelines[PipelineTypeClear] = LoadComputePipeline(device, "clear.comp");
-    pipelines[PipelineTypeDiffuse] = LoadComputePipeline(device, "diffuse.comp");
-    pipelines[PipelineTypeProject1] = LoadComputePipeline(device, "project1.comp");
-    pipelines[PipelineTypeProject2] = LoadComputePipeline(device, "project2.comp");
-    pipelines[PipelineTypeProject3] = LoadComputePipeline(device, "project3.comp");
-    pipelines[PipelineTypeAdvect1] = LoadComputePipeline(device, "advect1.comp");
-    pipelines[PipelineTypeAdvect2] = LoadComputePipeline(device, "advect2.comp");
-    pipelines[PipelineTypeBnd1] = LoadComputePipeline(device, "bnd1.comp");
-    pipelines[PipelineTypeBnd2] = LoadComputePipeline(device, "bnd2.comp");
-    pipelines[PipelineTypeBnd3] = LoadComputePipeline(device, "bnd3.comp");
-    pipelines[PipelineTypeBnd4] = LoadComputePipeline(device, "bnd4.comp");
-    pipelines[PipelineTypeBnd5] = LoadComputePipeline(device, "bnd5.comp");
-    pipelines[PipelineTypeBrush] = LoadComputePipeline(device, "brush.comp");
-    pipelines[PipelineTypeRaymarch] = LoadComputePipeline(device, "raymarch.comp");
+    pipelines[PipelineTypeClear] = LoadComputePipeline(device, "clear.comp", &reflections[PipelineTypeClear]);
+    pipelines[PipelineTypeDiffuse] = LoadComputePipeline(device, "diffuse.comp", &reflections[PipelineTypeDiffuse]);
+    pipelines[PipelineTypeDiffuse3] = LoadComputePipeline(device, "diffuse3.comp", &reflections[PipelineTypeDiffuse3]);
+    pipelines[PipelineTypeDiffuseTiled] = LoadComputePipeline(device, "diffuse_tiled.comp", &reflections[PipelineTypeDiffuseTiled]);
+    pipelines[PipelineTypeProject1] = LoadComputePipeline(device, "project1.comp", &reflections[PipelineTypeProject1]);
+    pipelines[PipelineTypeProject2] = LoadComputePipeline(device, "project2.comp", &reflections[PipelineTypeProject2]);
+    pipelines[PipelineTypeProject2Tiled] = LoadComputePipeline(device, "project2_tiled.comp", &reflections[PipelineTypeProject2Tiled]);
+    pipelines[PipelineTypeProject3] = LoadComputePipeline(device, "project3.comp", &reflections[PipelineTypeProject3]);
+    pipelines[PipelineTypeAdvect1] = LoadComputePipeline(device, "advect1.comp", &reflections[PipelineTypeAdvect1]);
+    pipelines[PipelineTypeAdvect2] = LoadComputePipeline(device, "advect2.comp", &reflections[PipelineTypeAdvect2]);
+    pipelines[PipelineTypeBnd] = LoadComputePipeline(device, "bnd.comp", &reflections[PipelineTypeBnd]);
+    pipelines[PipelineTypeBrush] = LoadComputePipeline(device, "brush.comp", &reflections[PipelineTypeBrush]);
+    pipelines[PipelineTypeRaymarch] = LoadComputePipeline(device, "raymarch.comp", &reflections[PipelineTypeRaymarch]);
+    pipelines[PipelineTypeResidual] = LoadComputePipeline(device, "residual.comp", &reflections[PipelineTypeResidual]);
+    pipelines[PipelineTypeRestrict] = LoadComputePipeline(device, "restrict.comp", &reflections[PipelineTypeRestrict]);
+    pipelines[PipelineTypeProlong] = LoadComputePipeline(device, "prolong.comp", &reflections[PipelineTypeProlong]);
+    pipelines[PipelineTypeSolver] = LoadComputePipeline(device, "solver.comp", &reflections[PipelineTypeSolver]);
+    pipelines[PipelineTypeSpawn] = LoadComputePipeline(device, "spawn.comp", &reflections[PipelineTypeSpawn]);
+    pipelines[PipelineTypeOccupancy] = LoadComputePipeline(device, "occupancy.comp", &reflections[PipelineTypeOccupancy]);
+    pipelines[PipelineTypeCompact] = LoadComputePipeline(device, "compact.comp", &reflections[PipelineTypeCompact]);
+    pipelines[PipelineTypeClearBricks] = LoadComputePipeline(device, "clear_bricks.comp", &reflections[PipelineTypeClearBricks]);
+    pipelines[PipelineTypeMacrocell] = LoadComputePipeline(device, "macrocell.comp", &reflections[PipelineTypeMacrocell]);
+    pipelines[PipelineTypePack] = LoadComputePipeline(device, "pack.comp", &reflections[PipelineTypePack]);
+    pipelines[PipelineTypeInterpolate] = LoadComputePipeline(device, "interpolate.comp", &reflections[PipelineTypeInterpolate]);
     for (int i = PipelineTypeCount - 1; i >= 0; i--)
     {
         if (!pipelines[i])
@@ -245,6 +715,29 @@ static bool CreatePipelines()
     return true;
 }
 
+static bool CreateBuffers()
+{
+    SDL_GPUBufferCreateInfo info{};
+    info.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+    info.size = kSolverSize;
+    solverBuffer = SDL_CreateGPUBuffer(device, &info);
+    if (!solverBuffer)
+    {
+        SDL_Log("Failed to create buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUTransferBufferCreateInfo transferInfo{};
+    transferInfo.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+    transferInfo.size = kSolverSize;
+    solverTransferBuffer = SDL_CreateGPUTransferBuffer(device, &transferInfo);
+    if (!solverTransferBuffer)
+    {
+        SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
 static bool Resize()
 {
     float ratio = float(swapchainWidth) / swapchainHeight;
@@ -274,13 +767,104 @@ static bool Resize()
     return true;
 }
 
+static void BindPipeline(SDL_GPUComputePass* computePass, PipelineType type)
+{
+    SDL_BindGPUComputePipeline(computePass, pipelines[type]);
+    boundPipeline = type;
+}
+
+static Uint64 GetBoundBytes(Uint64 threads)
+{
+    const SDL_GPUComputePipelineCreateInfo& reflection = reflections[boundPipeline];
+    Uint64 textures = reflection.num_samplers + reflection.num_readonly_storage_textures + reflection.num_readwrite_storage_textures;
+    return textures * threads * sizeof(float);
+}
+
+static void AddTraffic(Uint64 threads)
+{
+    const Traffic& traffic = kTraffic[boundPipeline];
+    dispatchTraffic.ReadBytes += double(threads) * traffic.Reads * sizeof(float);
+    dispatchTraffic.WriteBytes += double(threads) * traffic.Writes * sizeof(float);
+    dispatchTraffic.Flops += double(threads) * traffic.Flops;
+}
+
+static void Dispatch(SDL_GPUComputePass* computePass, Uint32 groupsX, Uint32 groupsY, Uint32 groupsZ)
+{
+    const SDL_GPUComputePipelineCreateInfo& reflection = reflections[boundPipeline];
+    Uint64 threads = Uint64(groupsX) * groupsY * groupsZ * reflection.threadcount_x * reflection.threadcount_y * reflection.threadcount_z;
+    profiler.Dispatch(groupsX, groupsY, groupsZ, GetBoundBytes(threads));
+    AddTraffic(threads);
+    SDL_DispatchGPUCompute(computePass, groupsX, groupsY, groupsZ);
+}
+
+static void DispatchIndirect(SDL_GPUComputePass* computePass, const glm::ivec3& size, SDL_GPUBuffer* buffer, Uint32 offset)
+{
+    // The brick count lives on the GPU so assume every brick of the dispatched level is active
+    const SDL_GPUComputePipelineCreateInfo& reflection = reflections[boundPipeline];
+    Uint64 cells = Uint64(size.x) * size.y * size.z;
+    Uint64 threads = cells * reflection.threadcount_x * reflection.threadcount_y * reflection.threadcount_z / (THREADS * THREADS * THREADS);
+    profiler.Dispatch(0, 0, 0, GetBoundBytes(threads));
+    AddTraffic(threads);
+    SDL_DispatchGPUComputeIndirect(computePass, buffer, offset);
+}
+
+static glm::ivec3 GetGroups(const glm::ivec3& size)
+{
+    return (size + THREADS - 1) / THREADS;
+}
+
+static int GetResolution()
+{
+    return std::max({gridSize.x, gridSize.y, gridSize.z});
+}
+
+static int GetBrickCount(const glm::ivec3& size)
+{
+    glm::ivec3 bricks = GetGroups(size);
+    return bricks.x * bricks.y * bricks.z;
+}
+
+static bool IsSparse()
+{
+    return settings.Sparse && !settings.Tiled && settings.PressureSolver != PressureSolverMultigrid;
+}
+
+static SDL_GPUBuffer* GetBricks(int level)
+{
+    return level == 0 && IsSparse() ? activeBricksBuffer : levels[level].Bricks;
+}
+
+static ReadWriteTexture& GetPressure(int level)
+{
+    return level ? levels[level].Pressure : textures[TextureTypePressure];
+}
+
+static ReadWriteTexture& GetRhs(int level)
+{
+    return level ? levels[level].Rhs : textures[TextureTypeDivergence];
+}
+
+static bool IsInterpolating()
+{
+    return renderFrame->Interpolated.load(std::memory_order_relaxed) && renderSteps;
+}
+
+static SDL_GPUTexture* GetRenderTexture(int type)
+{
+    if (type == TextureTypeDensity && IsInterpolating())
+    {
+        return interpolatedTexture;
+    }
+    return renderFrame->Textures[type];
+}
+
 static void UpdateViewProj()
 {
     forward.x = std::cos(pitch) * std::cos(yaw);
     forward.y = std::sin(pitch);
     forward.z = std::cos(pitch) * std::sin(yaw);
     float ratio = float(colorWidth) / colorHeight;
-    glm::vec3 center = glm::vec3(kSize / 2);
+    glm::vec3 center = glm::vec3(renderFrame->Size / 2);
     position = center - forward * distance;
     view = glm::lookAt(position, position + forward, {0.0f, 1.0f, 0.0f});
     proj = glm::perspective(kFov, ratio, kNear, kFar);
@@ -291,7 +875,7 @@ static void UpdateViewProj()
 
 static void UpdateBrush(float mouseX, float mouseY, float deltaX, float deltaY)
 {
-    if (!swapchainWidth || !swapchainHeight)
+    if (!renderFrame || !swapchainWidth || !swapchainHeight)
     {
         return;
     }
@@ -311,9 +895,9 @@ static void UpdateBrush(float mouseX, float mouseY, float deltaX, float deltaY)
     {
         return;
     }
-    glm::vec3 center = glm::vec3(kSize / 2);
+    glm::vec3 center = glm::vec3(renderFrame->Size / 2);
     glm::vec3 hit = position + direction * (glm::dot(center - position, forward) / denominator);
-    if (glm::any(glm::lessThan(hit, glm::vec3(0.0f))) || glm::any(glm::greaterThanEqual(hit, glm::vec3(kSize))))
+    if (glm::any(glm::lessThan(hit, glm::vec3(0.0f))) || glm::any(glm::greaterThanEqual(hit, glm::vec3(renderFrame->Size))))
     {
         return;
     }
@@ -324,98 +908,475 @@ static void UpdateBrush(float mouseX, float mouseY, float deltaX, float deltaY)
     brushActive = true;
 }
 
-static void Add1(SDL_GPUCommandBuffer* commandBuffer, TextureType texture, const glm::ivec3& position, float value)
+static void Clear(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, float value = 0.0f)
 {
     DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = textures[texture].BeginReadPass(commandBuffer);
+    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
     if (!computePass)
     {
         SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
         return;
     }
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeAdd1]);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &position, sizeof(position));
-    SDL_PushGPUComputeUniformData(commandBuffer, 1, &value, sizeof(value));
-    SDL_DispatchGPUCompute(computePass, 1, 1, 1);
+    glm::ivec3 groups = GetGroups(texture.GetSize());
+    BindPipeline(computePass, PipelineTypeClear);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &value, sizeof(value));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
     SDL_EndGPUComputePass(computePass);
 }
 
-static void Clear(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, float value = 0.0f)
+static SDL_GPUBuffer* CreateBrickBuffer(SDL_GPUBuffer* buffer, int count)
+{
+    SDL_ReleaseGPUBuffer(device, buffer);
+    SDL_GPUBufferCreateInfo info{};
+    info.usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+    info.size = count * sizeof(Uint32);
+    buffer = SDL_CreateGPUBuffer(device, &info);
+    if (!buffer)
+    {
+        SDL_Log("Failed to create buffer: %s", SDL_GetError());
+    }
+    return buffer;
+}
+
+static void Compact(SDL_GPUCommandBuffer* commandBuffer, Uint32 mode, SDL_GPUBuffer* bricks, const glm::ivec3& size)
 {
     DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
+    SDL_GPUStorageBufferReadWriteBinding readWriteBufferBindings[3]{};
+    readWriteBufferBindings[0].buffer = occupancyBuffer;
+    readWriteBufferBindings[1].buffer = bricks;
+    readWriteBufferBindings[2].buffer = clearBricksBuffer;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, nullptr, 0, readWriteBufferBindings, 3);
     if (!computePass)
     {
         SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
         return;
     }
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeClear]);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &value, sizeof(value));
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+    glm::ivec3 count = GetGroups(size);
+    int groups = 1;
+    if (mode != BrickModeReset && mode != BrickModeArguments)
+    {
+        groups = (GetBrickCount(size) + THREADS * THREADS - 1) / (THREADS * THREADS);
+    }
+    BindPipeline(computePass, PipelineTypeCompact);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &mode, sizeof(mode));
+    SDL_PushGPUComputeUniformData(commandBuffer, 1, &count, sizeof(count));
+    Dispatch(computePass, groups, 1, 1);
     SDL_EndGPUComputePass(computePass);
 }
 
-static bool CreateCells()
+static void FreeFrame(Frame* frame)
 {
-    SDL_ReleaseGPUTexture(device, scratchTexture);
-    SDL_GPUTextureCreateInfo info{};
-    info.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
-    info.type = SDL_GPU_TEXTURETYPE_3D;
-    info.usage = SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ;
-    info.width = kSize;
-    info.height = kSize;
-    info.layer_count_or_depth = kSize;
-    info.num_levels = 1;
-    scratchTexture = SDL_CreateGPUTexture(device, &info);
-    if (!scratchTexture)
-    {
-        SDL_Log("Failed to create texture: %s", SDL_GetError());
-        return false;
-    }
-    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
-    if (!commandBuffer)
+    if (!frame)
     {
-        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
-        return false;
+        return;
     }
     for (int i = 0; i < TextureTypeCount; i++)
     {
-        if (!textures[i].Create(device, kSize))
-        {
-            SDL_Log("Failed to create texture: %d", i);
-            return false;
-        }
-        Clear(commandBuffer, textures[i]);
-        textures[i].Swap();
-        Clear(commandBuffer, textures[i]);
+        SDL_ReleaseGPUTexture(device, frame->Textures[i]);
     }
-    SDL_SubmitGPUCommandBuffer(commandBuffer);
-    return true;
+    SDL_ReleaseGPUTexture(device, frame->Previous);
+    delete frame->SpawnerEvents.load();
+    delete frame;
 }
 
-static void SaveCallback(void *userdata, const char* const* filelist, int filter)
+static Frame* CreateFrame(const glm::ivec3& size)
 {
-    if (!filelist || !filelist[0])
+    Frame* frame = new Frame{};
+    frame->Size = size;
+    SDL_GPUTextureCreateInfo info{};
+    info.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
+    info.type = SDL_GPU_TEXTURETYPE_3D;
+    info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ;
+    info.width = size.x;
+    info.height = size.y;
+    info.layer_count_or_depth = size.z;
+    info.num_levels = 1;
+    bool created = true;
+    for (int i = 0; i < TextureTypeCount; i++)
     {
-        return;
+        frame->Textures[i] = SDL_CreateGPUTexture(device, &info);
+        created &= frame->Textures[i] != nullptr;
     }
-    std::ofstream file(filelist[0]);
-    if (!file)
+    frame->Previous = SDL_CreateGPUTexture(device, &info);
+    if (!created || !frame->Previous)
     {
-        SDL_Log("Failed to open file: %s", filelist[0]);
+        SDL_Log("Failed to create texture: %s", SDL_GetError());
+        FreeFrame(frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+static void CopyFrame(SDL_GPUCommandBuffer* commandBuffer, Frame* frame)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return;
+    }
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        SDL_GPUTextureLocation source{};
+        source.texture = textures[i].GetReadTexture();
+        SDL_GPUTextureLocation destination{};
+        destination.texture = frame->Textures[i];
+        SDL_CopyGPUTextureToTexture(copyPass, &source, &destination, gridSize.x, gridSize.y, gridSize.z, false);
+    }
+    SDL_EndGPUCopyPass(copyPass);
+}
+
+static void RestoreFrame(SDL_GPUCommandBuffer* commandBuffer, Frame* frame)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
         return;
     }
-    std::lock_guard lock(mutex);
-    try
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        SDL_GPUTextureLocation source{};
+        source.texture = frame->Textures[i];
+        SDL_GPUTextureLocation destination{};
+        destination.texture = textures[i].GetReadTexture();
+        SDL_CopyGPUTextureToTexture(copyPass, &source, &destination, gridSize.x, gridSize.y, gridSize.z, false);
+    }
+    SDL_EndGPUCopyPass(copyPass);
+}
+
+static bool PublishFrame(Frame* frame)
+{
+    while (!frames.Push(std::move(frame)))
+    {
+        if (!simulating)
+        {
+            FreeFrame(frame);
+            return false;
+        }
+        SDL_DelayNS(kIdleDelay);
+    }
+    simulationFrame = frame;
+    return true;
+}
+
+static bool CreateCells(const glm::ivec3& size, const State* scene, const CheckpointHeader* checkpoint)
+{
+    if (glm::any(glm::lessThan(size, glm::ivec3(4))))
+    {
+        SDL_Log("Invalid grid size: %d, %d, %d", size.x, size.y, size.z);
+        return false;
+    }
+    gridSize = size;
+    if (recorder.IsOpen() && recorder.GetSize() != gridSize)
+    {
+        SDL_Log("Stopping recording: grid size changed");
+        recorder.Close();
+    }
+    SDL_GPUTextureCreateInfo info{};
+    info.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
+    info.type = SDL_GPU_TEXTURETYPE_3D;
+    info.usage = SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ;
+    info.width = gridSize.x;
+    info.height = gridSize.y;
+    info.layer_count_or_depth = gridSize.z;
+    info.num_levels = 1;
+    for (int i = 0; i < 3; i++)
+    {
+        SDL_ReleaseGPUTexture(device, scratchTextures[i]);
+        scratchTextures[i] = SDL_CreateGPUTexture(device, &info);
+        if (!scratchTextures[i])
+        {
+            SDL_Log("Failed to create texture: %s", SDL_GetError());
+            return false;
+        }
+    }
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
+    }
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        if (!textures[i].Create(device, gridSize))
+        {
+            SDL_Log("Failed to create texture: %d", i);
+            return false;
+        }
+        Clear(commandBuffer, textures[i]);
+        textures[i].Swap();
+        Clear(commandBuffer, textures[i]);
+    }
+    levelCount = 1;
+    for (glm::ivec3 size = gridSize - 2; std::min({size.x, size.y, size.z}) > kMinLevelSize && levelCount < kMaxLevels; levelCount++)
+    {
+        size = (size + 1) / 2;
+        MultigridLevel& level = levels[levelCount];
+        if (!level.Pressure.Create(device, size + 2) || !level.Rhs.Create(device, size + 2))
+        {
+            SDL_Log("Failed to create level: %d", levelCount);
+            return false;
+        }
+        Clear(commandBuffer, level.Pressure);
+        Clear(commandBuffer, level.Rhs);
+    }
+    for (int i = 0; i < std::max(levelCount - 1, 1); i++)
+    {
+        if (!levels[i].Residual.Create(device, GetPressure(i).GetSize()))
+        {
+            SDL_Log("Failed to create level: %d", i);
+            return false;
+        }
+        Clear(commandBuffer, levels[i].Residual);
+    }
+    int brickCount = GetBrickCount(gridSize);
+    occupancyBuffer = CreateBrickBuffer(occupancyBuffer, brickCount);
+    activeBricksBuffer = CreateBrickBuffer(activeBricksBuffer, kBrickList + brickCount);
+    clearBricksBuffer = CreateBrickBuffer(clearBricksBuffer, kBrickList + brickCount);
+    if (!occupancyBuffer || !activeBricksBuffer || !clearBricksBuffer)
+    {
+        return false;
+    }
+    for (int i = 0; i < levelCount; i++)
+    {
+        const glm::ivec3& size = GetPressure(i).GetSize();
+        levels[i].Bricks = CreateBrickBuffer(levels[i].Bricks, kBrickList + GetBrickCount(size));
+        if (!levels[i].Bricks)
+        {
+            return false;
+        }
+        Compact(commandBuffer, BrickModeFill, levels[i].Bricks, size);
+        Compact(commandBuffer, BrickModeArguments, levels[i].Bricks, size);
+    }
+    sparseReset = true;
+    timelineIndex = 0;
+    Frame* frame = CreateFrame(gridSize);
+    if (!frame)
+    {
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return false;
+    }
+    if (scene)
+    {
+        frame->Scene = *scene;
+    }
+    if (checkpoint)
+    {
+        frame->Checkpoint = *checkpoint;
+    }
+    CopyFrame(commandBuffer, frame);
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    return PublishFrame(frame);
+}
+
+static bool CreateRender()
+{
+    const glm::ivec3& size = renderFrame->Size;
+    SDL_GPUTextureCreateInfo info{};
+    info.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
+    info.type = SDL_GPU_TEXTURETYPE_3D;
+    info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE;
+    info.width = size.x;
+    info.height = size.y;
+    info.layer_count_or_depth = size.z;
+    info.num_levels = 1;
+    SDL_ReleaseGPUTexture(device, interpolatedTexture);
+    interpolatedTexture = SDL_CreateGPUTexture(device, &info);
+    SDL_ReleaseGPUTexture(device, renderTexture);
+    info.format = SDL_GPU_TEXTUREFORMAT_R16G16B16A16_FLOAT;
+    info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE;
+    renderTexture = SDL_CreateGPUTexture(device, &info);
+    if (!interpolatedTexture || !renderTexture)
+    {
+        SDL_Log("Failed to create texture: %s", SDL_GetError());
+        return false;
+    }
+    SDL_ReleaseGPUBuffer(device, macrocellBuffer);
+    SDL_GPUBufferCreateInfo bufferInfo{};
+    bufferInfo.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+    bufferInfo.size = GetBrickCount(size) * 2 * sizeof(float);
+    macrocellBuffer = SDL_CreateGPUBuffer(device, &bufferInfo);
+    if (!macrocellBuffer)
+    {
+        SDL_Log("Failed to create buffer: %s", SDL_GetError());
+        return false;
+    }
+    renderDirty = true;
+    return true;
+}
+
+static bool UpdateFrame()
+{
+    Frame* frame;
+    bool changed = false;
+    while (frames.Pop(frame))
+    {
+        FreeFrame(renderFrame);
+        renderFrame = frame;
+        changed = true;
+        if (frame->Scene)
+        {
+            state = std::move(*frame->Scene);
+            frame->Scene.reset();
+            ApplyParameters(state, newSettings);
+        }
+        if (frame->Checkpoint)
+        {
+            newSettings.Speed = frame->Checkpoint->Speed;
+            newSettings.Diffusion = frame->Checkpoint->Diffusion;
+            newSettings.Viscosity = frame->Checkpoint->Viscosity;
+            newSettings.StepRate = std::max(frame->Checkpoint->StepRate, 1);
+            ApplyParameters(state, newSettings);
+        }
+    }
+    if (!renderFrame)
+    {
+        return false;
+    }
+    if (changed)
+    {
+        state.Size = {renderFrame->Size.x, renderFrame->Size.y, renderFrame->Size.z};
+        newGridSize = renderFrame->Size;
+        renderSteps = 0;
+        headlessTime = 0;
+        if (!headless && !CreateRender())
+        {
+            return false;
+        }
+    }
+    std::vector<TimelineEvent>* events = renderFrame->SpawnerEvents.exchange(nullptr);
+    if (events)
+    {
+        for (const TimelineEvent& event : *events)
+        {
+            if (event.Spawner < state.Spawners.size())
+            {
+                state.Spawners[event.Spawner].Enabled = event.Type == TimelineEventTypeSpawnerOn;
+            }
+        }
+        delete events;
+    }
+    Uint64 steps = renderFrame->Steps.load(std::memory_order_acquire);
+    if (renderSteps != steps)
+    {
+        renderSteps = steps;
+        renderDirty = true;
+    }
+    return headless || (renderTexture && interpolatedTexture && macrocellBuffer);
+}
+
+static bool Send(Command&& command)
+{
+    if (!commands.Push(std::move(command)))
+    {
+        SDL_Log("Failed to send command: %d", command.Type);
+        return false;
+    }
+    return true;
+}
+
+static void SendReset()
+{
+    Command command{};
+    command.Type = CommandTypeReset;
+    command.Scene.Size = state.Size;
+    Send(std::move(command));
+}
+
+static void SendLoad(const char* path)
+{
+    Command command{};
+    command.Type = IsCheckpoint(path) ? CommandTypeRestore : CommandTypeLoad;
+    command.Path = path;
+    Send(std::move(command));
+}
+
+static void SendCommands()
+{
+    std::string* path = savePath.exchange(nullptr);
+    if (path)
+    {
+        Command command{};
+        command.Type = CommandTypeSave;
+        command.Scene = state;
+        command.Path = std::move(*path);
+        Send(std::move(command));
+        delete path;
+    }
+    path = loadPath.exchange(nullptr);
+    if (path)
+    {
+        SendLoad(path->data());
+        delete path;
+    }
+    path = tracePath.exchange(nullptr);
+    if (path)
+    {
+        traceFile = std::move(*path);
+        profiler.StartCapture(traceFrames);
+        delete path;
+    }
+    path = checkpointPath.exchange(nullptr);
+    if (path)
+    {
+        Command command{};
+        command.Type = CommandTypeCheckpoint;
+        command.Path = std::move(*path);
+        Send(std::move(command));
+        delete path;
+    }
+    path = recordPath.exchange(nullptr);
+    if (path)
+    {
+        Command command{};
+        command.Type = CommandTypeRecord;
+        command.Path = std::move(*path);
+        Send(std::move(command));
+        delete path;
+    }
+    if (newSettings != sentSettings)
+    {
+        Command command{};
+        command.Type = CommandTypeSettings;
+        command.Settings = newSettings;
+        if (Send(std::move(command)))
+        {
+            sentSettings = newSettings;
+        }
+    }
+    if (spawnersChanged)
+    {
+        Command command{};
+        command.Type = CommandTypeSpawners;
+        command.Scene.Spawners = state.Spawners;
+        spawnersChanged = !Send(std::move(command));
+    }
+    if (brushActive)
     {
-        nlohmann::json json = state;
-        file << json.dump(4);
+        Command command{};
+        command.Type = CommandTypeBrush;
+        command.Brush.Position = brushPosition;
+        command.Brush.Radius = brushRadius;
+        command.Brush.Velocity = brushVelocity;
+        command.Brush.Dye = brushDye;
+        if (Send(std::move(command)))
+        {
+            brushVelocity = glm::vec3(0.0f);
+            brushActive = false;
+        }
     }
-    catch (const std::exception& exception)
+}
+
+static void SaveCallback(void *userdata, const char* const* filelist, int filter)
+{
+    if (!filelist || !filelist[0])
     {
-        SDL_Log("Failed to save json: %s, %s", filelist[0], exception.what());
+        return;
     }
+    delete savePath.exchange(new std::string(filelist[0]));
 }
 
 static void LoadCallback(void *userdata, const char* const* filelist, int filter)
@@ -424,29 +1385,39 @@ static void LoadCallback(void *userdata, const char* const* filelist, int filter
     {
         return;
     }
-    std::ifstream file(filelist[0]);
-    if (!file)
+    delete loadPath.exchange(new std::string(filelist[0]));
+}
+
+static void CheckpointCallback(void *userdata, const char* const* filelist, int filter)
+{
+    if (!filelist || !filelist[0])
     {
-        SDL_Log("Failed to open file: %s", filelist[0]);
         return;
     }
-    std::lock_guard lock(mutex);
-    nlohmann::json json;
-    try
+    delete checkpointPath.exchange(new std::string(filelist[0]));
+}
+
+static void TraceCallback(void *userdata, const char* const* filelist, int filter)
+{
+    if (!filelist || !filelist[0])
     {
-        file >> json;
-        state = json;
+        return;
     }
-    catch (const std::exception& exception)
+    delete tracePath.exchange(new std::string(filelist[0]));
+}
+
+static void RecordCallback(void *userdata, const char* const* filelist, int filter)
+{
+    if (!filelist || !filelist[0])
     {
-        SDL_Log("Failed to load json: %s, %s", filelist[0], exception.what());
         return;
     }
-    CreateCells();
+    delete recordPath.exchange(new std::string(filelist[0]));
 }
 
-static void UpdateSpawners(SDL_GPUCommandBuffer* commandBuffer)
+static void UpdateSpawners()
 {
+    int resolution = std::max({renderFrame->Size.x, renderFrame->Size.y, renderFrame->Size.z});
     std::vector<int> removes;
     for (int i = 0; i < state.Spawners.size(); i++)
     {
@@ -454,9 +1425,17 @@ static void UpdateSpawners(SDL_GPUCommandBuffer* commandBuffer)
         std::string positionId = std::format("##position{}", i);
         std::string valueId = std::format("##value{}", i);
         std::string textureId = std::format("##texture{}", i);
+        std::string enabledId = std::format("Enabled##enabled{}", i);
         Spawner& spawner = state.Spawners[i];
-        ImGui::SliderInt3(positionId.data(), spawner.Position, 1, kSize - 2);
-        ImGui::DragFloat(valueId.data(), &spawner.Value, 1.0f);
+        if (ImGui::SliderInt3(positionId.data(), spawner.Position.data(), 1, resolution - 2))
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                spawner.Position[j] = std::clamp(spawner.Position[j], 1, renderFrame->Size[j] - 2);
+            }
+            spawnersChanged = true;
+        }
+        spawnersChanged |= ImGui::DragFloat(valueId.data(), &spawner.Value, 1.0f);
         if (ImGui::BeginCombo(textureId.data(), Textures[spawner.Texture]))
         {
             for (int j = 0; j < SDL_arraysize(Spawners); j++)
@@ -465,6 +1444,7 @@ static void UpdateSpawners(SDL_GPUCommandBuffer* commandBuffer)
                 if (ImGui::Selectable(Textures[Spawners[j]], isSelected))
                 {
                     spawner.Texture = Spawners[j];
+                    spawnersChanged = true;
                 }
                 if (isSelected)
                 {
@@ -473,30 +1453,157 @@ static void UpdateSpawners(SDL_GPUCommandBuffer* commandBuffer)
             }
             ImGui::EndCombo();
         }
+        spawnersChanged |= ImGui::Checkbox(enabledId.data(), &spawner.Enabled);
+        ImGui::SameLine();
         if (ImGui::Button(removeId.data()))
         {
             removes.push_back(i);
         }
-        int x = spawner.Position[0];
-        int y = spawner.Position[1];
-        int z = spawner.Position[2];
-        Add1(commandBuffer, spawner.Texture, {x, y, z}, spawner.Value);
         ImGui::Separator();
     }
     for (auto it = removes.rbegin(); it != removes.rend(); it++)
     {
         state.Spawners.erase(state.Spawners.begin() + *it);
+        spawnersChanged = true;
     }
     if (ImGui::Button("Add##Spawner"))
     {
         Spawner spawner{};
         spawner.Texture = TextureTypeDensity;
         spawner.Value = 1.0f;
-        int center = kSize / 2 - 1;
-        spawner.Position[0] = center;
-        spawner.Position[1] = center;
-        spawner.Position[2] = center;
+        spawner.Position[0] = renderFrame->Size.x / 2 - 1;
+        spawner.Position[1] = renderFrame->Size.y / 2 - 1;
+        spawner.Position[2] = renderFrame->Size.z / 2 - 1;
         state.Spawners.push_back(spawner);
+        spawnersChanged = true;
+    }
+}
+
+static void UpdateProfilerFrame(ProfilerThread thread)
+{
+    static ProfilerFrame frame;
+    profiler.GetFrame(thread, frame);
+    float rowHeight = ImGui::GetTextLineHeight();
+    int depth = 1;
+    for (const ProfilerEvent& event : frame.Events)
+    {
+        depth = std::max(depth, event.Depth + 1);
+    }
+    ImGui::Text("%s: %.3f ms", ProfilerThreads[thread], float(frame.End - frame.Begin) / SDL_NS_PER_MS);
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size{ImGui::GetContentRegionAvail().x, depth * rowHeight};
+    ImGui::InvisibleButton(ProfilerThreads[thread], ImVec2{std::max(size.x, 1.0f), size.y});
+    if (frame.End <= frame.Begin)
+    {
+        return;
+    }
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    float scale = size.x / float(frame.End - frame.Begin);
+    for (const ProfilerEvent& event : frame.Events)
+    {
+        ImVec2 min{origin.x + (event.Begin - frame.Begin) * scale, origin.y + event.Depth * rowHeight};
+        ImVec2 max{std::max(origin.x + (event.End - frame.Begin) * scale, min.x + 1.0f), min.y + rowHeight - 1.0f};
+        ImU32 color = ImGui::GetColorU32(ImGuiCol_PlotHistogram, 1.0f - 0.15f * (event.Depth % 4));
+        drawList->AddRectFilled(min, max, color);
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(min, ImGui::GetColorU32(ImGuiCol_Text), event.Name);
+        drawList->PopClipRect();
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s: %.3f ms", event.Name, float(event.End - event.Begin) / SDL_NS_PER_MS);
+        }
+    }
+}
+
+static void UpdateRoofline()
+{
+    std::vector<RooflineResult>* report = rooflineReport.exchange(nullptr);
+    if (report)
+    {
+        rooflineResults = std::move(*report);
+        delete report;
+    }
+    if (rooflineResults.empty())
+    {
+        return;
+    }
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+    if (!ImGui::BeginTable("Roofline", 5, flags))
+    {
+        return;
+    }
+    ImGui::TableSetupColumn("Kernel");
+    ImGui::TableSetupColumn("ms");
+    ImGui::TableSetupColumn("GB/s");
+    ImGui::TableSetupColumn("GFLOP/s");
+    ImGui::TableSetupColumn("FLOP/B");
+    ImGui::TableHeadersRow();
+    for (const RooflineResult& result : rooflineResults)
+    {
+        double bytes = result.Traffic.ReadBytes + result.Traffic.WriteBytes;
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(result.Name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", result.Ms);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", bytes / (result.Ms * 1e6));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", result.Traffic.Flops / (result.Ms * 1e6));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", result.Traffic.Flops / std::max(bytes, 1.0));
+    }
+    ImGui::EndTable();
+}
+
+static void UpdateProfiler()
+{
+    ImGui::SliderInt("Trace Frames", &traceFrames, 1, 600);
+    if (ImGui::Button("Roofline"))
+    {
+        Command command{};
+        command.Type = CommandTypeRoofline;
+        Send(std::move(command));
+    }
+    UpdateRoofline();
+    if (ImGui::Checkbox("Profile", &profiling))
+    {
+        profiler.SetEnabled(profiling);
+    }
+    if (!profiling)
+    {
+        return;
+    }
+    static std::vector<ProfilerZone> zones;
+    profiler.GetZones(zones);
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("Zones", 5, flags, ImVec2{0.0f, 12.0f * ImGui::GetTextLineHeightWithSpacing()}))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Thread");
+        ImGui::TableSetupColumn("p50 (ms)");
+        ImGui::TableSetupColumn("p95 (ms)");
+        ImGui::TableSetupColumn("p99 (ms)");
+        ImGui::TableHeadersRow();
+        for (const ProfilerZone& zone : zones)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(zone.Name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%s%s", ProfilerThreads[zone.Thread], zone.Gpu ? " (GPU)" : "");
+            for (int i = 0; i < ProfilerPercentileCount; i++)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", zone.Percentiles[i]);
+            }
+        }
+        ImGui::EndTable();
+    }
+    for (int i = 0; i < ProfilerThreadCount; i++)
+    {
+        UpdateProfilerFrame(ProfilerThread(i));
     }
 }
 
@@ -519,32 +1626,311 @@ static void UpdateImGui(SDL_GPUCommandBuffer* commandBuffer)
     {
         SDL_ShowOpenFileDialog(LoadCallback, nullptr, window, nullptr, 1, location, false);
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Checkpoint"))
+    {
+        SDL_ShowSaveFileDialog(CheckpointCallback, nullptr, window, nullptr, 1, location);
+    }
+    ImGui::SameLine();
+    if (!recorder.IsOpen() && ImGui::Button("Record"))
+    {
+        SDL_ShowSaveFileDialog(RecordCallback, nullptr, window, nullptr, 1, location);
+    }
+    else if (recorder.IsOpen() && ImGui::Button("Stop"))
+    {
+        Command command{};
+        command.Type = CommandTypeStop;
+        Send(std::move(command));
+    }
+    ImGui::SameLine();
+    if (traceFile.empty() && ImGui::Button("Trace"))
+    {
+        SDL_ShowSaveFileDialog(TraceCallback, nullptr, window, nullptr, 1, location);
+    }
     SDL_free(location);
     ImGui::SameLine();
     if (ImGui::Button("Reset"))
     {
-        CreateCells();
+        SendReset();
     }
     ImGui::SeparatorText("Settings");
-    ImGui::SliderFloat("Speed", &speed, 0.0f, 64.0f);
-    ImGui::SliderInt("Iterations", &iterations, 1, 50);
-    ImGui::SliderFloat("Diffusion", &diffusion, 0.0f, 0.0001f, "%.7f", ImGuiSliderFlags_Logarithmic);
-    ImGui::SliderFloat("Viscosity", &viscosity, 0.0f, 0.0001f, "%.7f", ImGuiSliderFlags_Logarithmic);
-    ImGui::SliderFloat("Brush Radius", &brushRadius, 1.0f, 32.0f);
-    ImGui::SliderFloat("Brush Strength", &brushStrength, 0.001f, 10.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
-    ImGui::SliderFloat("Brush Dye", &brushDye, 0.0f, 32.0f);
-    ImGui::SliderFloat("Dye Strength", &dyeStrength, 0.001f, 100.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
-    for (int i = 0; i < SDL_arraysize(Textures); i++)
+    ImGui::InputInt3("Grid Size", &newGridSize.x);
+    ImGui::SameLine();
+    if (ImGui::Button("Apply"))
     {
-        ImGui::RadioButton(Textures[i], &texture, i);
+        state.Size = {newGridSize.x, newGridSize.y, newGridSize.z};
+        SendReset();
     }
-    ImGui::SeparatorText("Spawners");
-    UpdateSpawners(commandBuffer);
-    ImGui::End();
-    ImGui::Render();
+    ImGui::SliderFloat("Speed", &newSettings.Speed, 0.0f, 64.0f);
+    ImGui::SliderInt("Step Rate", &newSettings.StepRate, 1, 240);
+    ImGui::SliderInt("Max Substeps", &newSettings.MaxSubsteps, 1, 16);
+    ImGui::Checkbox("Interpolate", &newSettings.Interpolate);
+    ImGui::SliderInt(newSettings.Adaptive ? "Max Iterations" : "Iterations", &newSettings.Iterations, 1, 50);
+    ImGui::Checkbox("Tiled", &newSettings.Tiled);
+    ImGui::Checkbox("Sparse", &newSettings.Sparse);
+    ImGui::SetItemTooltip("Approximates the dense solve, so results differ from it:\n"
+        "bricks below the threshold are zeroed, pressure is 0 outside active bricks and\n"
+        "active bricks grow by up to %d bricks, so advection past %d cells per step drops content",
+        BRICK_MAX_DILATION, BRICK_MAX_DILATION * THREADS);
+    if (newSettings.Sparse)
+    {
+        ImGui::SliderFloat("Sparse Threshold", &newSettings.SparseThreshold, 0.0000001f, 0.01f, "%.7f", ImGuiSliderFlags_Logarithmic);
+    }
+    ImGui::Checkbox("Adaptive", &newSettings.Adaptive);
+    if (newSettings.Adaptive)
+    {
+        ImGui::SliderInt("Check Interval", &newSettings.CheckInterval, 1, 16);
+        ImGui::SliderFloat("Diffuse Tolerance", &newSettings.DiffuseTolerance, 0.0000001f, 0.01f, "%.7f", ImGuiSliderFlags_Logarithmic);
+    }
+    ImGui::Combo("Pressure Solver", &newSettings.PressureSolver, PressureSolvers, SDL_arraysize(PressureSolvers));
+    if (newSettings.Adaptive || newSettings.PressureSolver == PressureSolverMultigrid)
+    {
+        ImGui::SliderFloat("Pressure Tolerance", &newSettings.PressureTolerance, 0.0000001f, 0.01f, "%.7f", ImGuiSliderFlags_Logarithmic);
+    }
+    if (newSettings.PressureSolver == PressureSolverMultigrid)
+    {
+        ImGui::SliderInt("Max Cycles", &newSettings.MaxCycles, 1, 32);
+    }
+    ImGui::SliderFloat("Diffusion", &newSettings.Diffusion, 0.0f, 0.0001f, "%.7f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Viscosity", &newSettings.Viscosity, 0.0f, 0.0001f, "%.7f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Brush Radius", &brushRadius, 1.0f, 32.0f);
+    ImGui::SliderFloat("Brush Strength", &brushStrength, 0.001f, 10.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Brush Dye", &brushDye, 0.0f, 32.0f);
+    ImGui::SliderFloat("Dye Strength", &dyeStrength, 0.001f, 100.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
+    for (int i = 0; i < SDL_arraysize(Textures); i++)
+    {
+        ImGui::RadioButton(Textures[i], &texture, i);
+    }
+    if (newSettings.Adaptive || newSettings.PressureSolver == PressureSolverMultigrid)
+    {
+        ImGui::SeparatorText("Solves");
+        for (int i = 0; i < SolveTypeCount; i++)
+        {
+            ImGui::Text("%s: %u (%.2e)", Solves[i], solveIterations[i].load(), solveResiduals[i].load());
+        }
+    }
+    ImGui::SeparatorText("Scheduler");
+    ImGui::Text("Real-Time Factor: %.2f", realTimeFactor.load());
+    ImGui::Text("Steps: %.1f/s", stepsPerSecond.load());
+    ImGui::SeparatorText("Recording");
+    ImGui::SliderInt("Record Interval", &newSettings.RecordInterval, 1, 60);
+    ImGui::Combo("Compression", &newSettings.Compression, Compressions, SDL_arraysize(Compressions));
+    if (newSettings.Compression == CompressionTypeQuantized)
+    {
+        ImGui::SliderFloat("Error Bound", &newSettings.ErrorBound, 0.000001f, 0.01f, "%.6f", ImGuiSliderFlags_Logarithmic);
+    }
+    ImGui::Text("Frames: %" SDL_PRIu64 " (%" SDL_PRIu64 " dropped)", recorder.GetWritten(), recorder.GetDropped());
+    ImGui::Text("Queue: %d/%d (max %d)", recorder.GetDepth(), Recorder::kSlots, recorder.GetMaxDepth());
+    ImGui::Text("Written: %.1f MB (%.1fx)", double(recorder.GetBytes()) / (1024.0 * 1024.0),
+        double(recorder.GetRawBytes()) / double(std::max<Uint64>(recorder.GetBytes(), 1)));
+    ImGui::SeparatorText("Profiler");
+    UpdateProfiler();
+    ImGui::SeparatorText("Spawners");
+    UpdateSpawners();
+    ImGui::End();
+    ImGui::Render();
     ImGui_ImplSDLGPU3_PrepareDrawData(ImGui::GetDrawData(), commandBuffer);
 }
 
+static bool UploadSpawners(SDL_GPUCommandBuffer* commandBuffer)
+{
+    std::vector<SpawnerStorageBuffer> spawners;
+    spawners.reserve(simulationSpawners.size());
+    for (const Spawner& spawner : simulationSpawners)
+    {
+        if (!spawner.Enabled)
+        {
+            continue;
+        }
+        SpawnerStorageBuffer data{};
+        data.Position = {spawner.Position[0], spawner.Position[1], spawner.Position[2]};
+        data.Texture = spawner.Texture;
+        data.Value = spawner.Value;
+        spawners.push_back(data);
+    }
+    auto key = [](const SpawnerStorageBuffer& spawner)
+    {
+        return std::tuple(spawner.Texture, spawner.Position.z, spawner.Position.y, spawner.Position.x);
+    };
+    std::sort(spawners.begin(), spawners.end(), [&](const auto& lhs, const auto& rhs)
+    {
+        return key(lhs) < key(rhs);
+    });
+    spawnerCount = 0;
+    for (const SpawnerStorageBuffer& spawner : spawners)
+    {
+        if (spawnerCount && key(spawners[spawnerCount - 1]) == key(spawner))
+        {
+            spawners[spawnerCount - 1].Value += spawner.Value;
+            continue;
+        }
+        spawners[spawnerCount++] = spawner;
+    }
+    if (!spawnerCount)
+    {
+        return true;
+    }
+    if (spawnerCount > spawnerCapacity)
+    {
+        Uint32 capacity = std::max(spawnerCount, 2 * spawnerCapacity);
+        SDL_GPUBufferCreateInfo info{};
+        info.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ;
+        info.size = capacity * sizeof(SpawnerStorageBuffer);
+        SDL_GPUBuffer* buffer = SDL_CreateGPUBuffer(device, &info);
+        if (!buffer)
+        {
+            SDL_Log("Failed to create buffer: %s", SDL_GetError());
+            return false;
+        }
+        SDL_GPUTransferBufferCreateInfo transferInfo{};
+        transferInfo.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        transferInfo.size = info.size;
+        SDL_GPUTransferBuffer* transferBuffer = SDL_CreateGPUTransferBuffer(device, &transferInfo);
+        if (!transferBuffer)
+        {
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            SDL_ReleaseGPUBuffer(device, buffer);
+            return false;
+        }
+        SDL_ReleaseGPUBuffer(device, spawnerBuffer);
+        SDL_ReleaseGPUTransferBuffer(device, spawnerTransferBuffer);
+        spawnerBuffer = buffer;
+        spawnerTransferBuffer = transferBuffer;
+        spawnerCapacity = capacity;
+    }
+    void* data = SDL_MapGPUTransferBuffer(device, spawnerTransferBuffer, true);
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+    std::memcpy(data, spawners.data(), spawnerCount * sizeof(SpawnerStorageBuffer));
+    SDL_UnmapGPUTransferBuffer(device, spawnerTransferBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUTransferBufferLocation location{};
+    location.transfer_buffer = spawnerTransferBuffer;
+    SDL_GPUBufferRegion region{};
+    region.buffer = spawnerBuffer;
+    region.size = spawnerCount * sizeof(SpawnerStorageBuffer);
+    SDL_UploadToGPUBuffer(copyPass, &location, &region, true);
+    SDL_EndGPUCopyPass(copyPass);
+    return true;
+}
+
+static void Spawn(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    if (spawnersDirty)
+    {
+        spawnersDirty = !UploadSpawners(commandBuffer);
+    }
+    if (!spawnerCount || spawnersDirty)
+    {
+        return;
+    }
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[4]{};
+    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetReadTexture();
+    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetReadTexture();
+    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetReadTexture();
+    readWriteTextureBindings[3].texture = textures[TextureTypeDensity].GetReadTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 4, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    int groups = (spawnerCount + THREADS * THREADS - 1) / (THREADS * THREADS);
+    BindPipeline(computePass, PipelineTypeSpawn);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &spawnerBuffer, 1);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &spawnerCount, sizeof(spawnerCount));
+    Dispatch(computePass, groups, 1, 1);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Occupancy(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageBufferReadWriteBinding readWriteBufferBinding{};
+    readWriteBufferBinding.buffer = occupancyBuffer;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, nullptr, 0, &readWriteBufferBinding, 1);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[4]{};
+    textureBindings[0] = textures[TextureTypeVelocityX].GetReadTexture();
+    textureBindings[1] = textures[TextureTypeVelocityY].GetReadTexture();
+    textureBindings[2] = textures[TextureTypeVelocityZ].GetReadTexture();
+    textureBindings[3] = textures[TextureTypeDensity].GetReadTexture();
+    glm::ivec3 groups = GetGroups(gridSize);
+    BindPipeline(computePass, PipelineTypeOccupancy);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
+    OccupancyUniformBuffer uniform{};
+    uniform.Threshold = settings.SparseThreshold;
+    uniform.DeltaTime = settings.Speed;
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &uniform, sizeof(uniform));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void ClearBricks(SDL_GPUCommandBuffer* commandBuffer)
+{
+    static constexpr TextureType kTextures[] =
+    {
+        TextureTypeVelocityX,
+        TextureTypeVelocityY,
+        TextureTypeVelocityZ,
+        TextureTypePressure,
+        TextureTypeDivergence,
+        TextureTypeDensity,
+    };
+    DebugGroup(commandBuffer);
+    for (int i = 0; i < 2; i++)
+    {
+        SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[6]{};
+        for (int j = 0; j < 6; j++)
+        {
+            ReadWriteTexture& texture = textures[kTextures[j]];
+            readWriteTextureBindings[j].texture = i ? texture.GetWriteTexture() : texture.GetReadTexture();
+        }
+        SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 6, nullptr, 0);
+        if (!computePass)
+        {
+            SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+            return;
+        }
+        BindPipeline(computePass, PipelineTypeClearBricks);
+        SDL_BindGPUComputeStorageBuffers(computePass, 0, &clearBricksBuffer, 1);
+        DispatchIndirect(computePass, gridSize, clearBricksBuffer, kBrickArguments * sizeof(Uint32));
+        SDL_EndGPUComputePass(computePass);
+    }
+}
+
+static void UpdateBricks(SDL_GPUCommandBuffer* commandBuffer)
+{
+    if (!IsSparse())
+    {
+        sparseReset = true;
+        return;
+    }
+    if (sparseReset)
+    {
+        Compact(commandBuffer, BrickModeMark, activeBricksBuffer, gridSize);
+        sparseReset = false;
+    }
+    Occupancy(commandBuffer);
+    Compact(commandBuffer, BrickModeReset, activeBricksBuffer, gridSize);
+    Compact(commandBuffer, BrickModeCompact, activeBricksBuffer, gridSize);
+    Compact(commandBuffer, BrickModeArguments, activeBricksBuffer, gridSize);
+    ClearBricks(commandBuffer);
+}
+
 static void Diffuse1(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, float diffusion, Uint32 phase)
 {
     DebugGroup(commandBuffer);
@@ -555,16 +1941,68 @@ static void Diffuse1(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& text
         return;
     }
     SDL_GPUTexture* textureBinding;
-    textureBinding = scratchTexture;
-    int groups = (kSize + THREADS - 1) / THREADS;
-    int groupsX = ((kSize + 1) / 2 + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeDiffuse]);
+    textureBinding = scratchTextures[0];
+    SDL_GPUBuffer* bufferBindings[2]{};
+    bufferBindings[0] = solverBuffer;
+    bufferBindings[1] = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeDiffuse);
     SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBinding, 1);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &speed, sizeof(speed));
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, bufferBindings, 2);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &settings.Speed, sizeof(settings.Speed));
+    SDL_PushGPUComputeUniformData(commandBuffer, 1, &diffusion, sizeof(diffusion));
+    SDL_PushGPUComputeUniformData(commandBuffer, 2, &phase, sizeof(phase));
+    DispatchIndirect(computePass, gridSize, bufferBindings[1], kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Diffuse3(SDL_GPUCommandBuffer* commandBuffer, float diffusion, Uint32 phase)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[3]{};
+    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetReadTexture();
+    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetReadTexture();
+    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetReadTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 3, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUBuffer* bufferBindings[2]{};
+    bufferBindings[0] = solverBuffer;
+    bufferBindings[1] = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeDiffuse3);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, scratchTextures, 3);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, bufferBindings, 2);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &settings.Speed, sizeof(settings.Speed));
     SDL_PushGPUComputeUniformData(commandBuffer, 1, &diffusion, sizeof(diffusion));
     SDL_PushGPUComputeUniformData(commandBuffer, 2, &phase, sizeof(phase));
-    SDL_DispatchGPUCompute(computePass, groupsX, groups, groups);
+    DispatchIndirect(computePass, gridSize, bufferBindings[1], kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void DiffuseTiled(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, SDL_GPUTexture* source, float diffusion, Uint32 type)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[2]{};
+    textureBindings[0] = texture.GetReadTexture();
+    textureBindings[1] = source;
+    glm::ivec3 groups = GetGroups(texture.GetSize());
+    BindPipeline(computePass, PipelineTypeDiffuseTiled);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 2);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &solverBuffer, 1);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &settings.Speed, sizeof(settings.Speed));
+    SDL_PushGPUComputeUniformData(commandBuffer, 1, &diffusion, sizeof(diffusion));
+    SDL_PushGPUComputeUniformData(commandBuffer, 2, &type, sizeof(type));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
     SDL_EndGPUComputePass(computePass);
+    texture.Swap();
 }
 
 static void Project1(SDL_GPUCommandBuffer* commandBuffer)
@@ -583,276 +2021,1260 @@ static void Project1(SDL_GPUCommandBuffer* commandBuffer)
     textureBindings[0] = textures[TextureTypeVelocityX].GetReadTexture();
     textureBindings[1] = textures[TextureTypeVelocityY].GetReadTexture();
     textureBindings[2] = textures[TextureTypeVelocityZ].GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeProject1]);
+    SDL_GPUBuffer* bufferBinding;
+    bufferBinding = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeProject1);
     SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 3);
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &bufferBinding, 1);
+    DispatchIndirect(computePass, gridSize, bufferBinding, kBrickArguments * sizeof(Uint32));
     SDL_EndGPUComputePass(computePass);
     textures[TextureTypePressure].Swap();
     textures[TextureTypeDivergence].Swap();
 }
 
-static void Project2(SDL_GPUCommandBuffer* commandBuffer, Uint32 phase)
+static void Project2(SDL_GPUCommandBuffer* commandBuffer, int level, Uint32 phase)
+{
+    DebugGroup(commandBuffer);
+    ReadWriteTexture& pressure = GetPressure(level);
+    SDL_GPUComputePass* computePass = pressure.BeginReadPass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBinding;
+    textureBinding = GetRhs(level).GetReadTexture();
+    SDL_GPUBuffer* bufferBindings[2]{};
+    bufferBindings[0] = solverBuffer;
+    bufferBindings[1] = GetBricks(level);
+    BindPipeline(computePass, PipelineTypeProject2);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBinding, 1);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, bufferBindings, 2);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &phase, sizeof(phase));
+    DispatchIndirect(computePass, pressure.GetSize(), bufferBindings[1], kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Project2Tiled(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& pressure, ReadWriteTexture& divergence)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUComputePass* computePass = pressure.BeginWritePass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[2]{};
+    textureBindings[0] = pressure.GetReadTexture();
+    textureBindings[1] = divergence.GetReadTexture();
+    glm::ivec3 groups = GetGroups(pressure.GetSize());
+    BindPipeline(computePass, PipelineTypeProject2Tiled);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 2);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &solverBuffer, 1);
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+    pressure.Swap();
+}
+
+static void Project3(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[3]{};
+    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetWriteTexture();
+    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetWriteTexture();
+    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetWriteTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 3, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[4]{};
+    textureBindings[0] = textures[TextureTypePressure].GetReadTexture();
+    textureBindings[1] = textures[TextureTypeVelocityX].GetReadTexture();
+    textureBindings[2] = textures[TextureTypeVelocityY].GetReadTexture();
+    textureBindings[3] = textures[TextureTypeVelocityZ].GetReadTexture();
+    SDL_GPUBuffer* bufferBinding;
+    bufferBinding = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeProject3);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &bufferBinding, 1);
+    DispatchIndirect(computePass, gridSize, bufferBinding, kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+    textures[TextureTypeVelocityX].Swap();
+    textures[TextureTypeVelocityY].Swap();
+    textures[TextureTypeVelocityZ].Swap();
+}
+
+static void Advect1(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[3]{};
+    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetWriteTexture();
+    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetWriteTexture();
+    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetWriteTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 3, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[3]{};
+    textureBindings[0] = textures[TextureTypeVelocityX].GetReadTexture();
+    textureBindings[1] = textures[TextureTypeVelocityY].GetReadTexture();
+    textureBindings[2] = textures[TextureTypeVelocityZ].GetReadTexture();
+    SDL_GPUBuffer* bufferBinding;
+    bufferBinding = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeAdvect1);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 3);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &bufferBinding, 1);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &settings.Speed, sizeof(settings.Speed));
+    DispatchIndirect(computePass, gridSize, bufferBinding, kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+    textures[TextureTypeVelocityX].Swap();
+    textures[TextureTypeVelocityY].Swap();
+    textures[TextureTypeVelocityZ].Swap();
+}
+
+static void Advect2(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUComputePass* computePass = textures[TextureTypeDensity].BeginWritePass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[4]{};
+    textureBindings[0] = textures[TextureTypeDensity].GetReadTexture();
+    textureBindings[1] = textures[TextureTypeVelocityX].GetReadTexture();
+    textureBindings[2] = textures[TextureTypeVelocityY].GetReadTexture();
+    textureBindings[3] = textures[TextureTypeVelocityZ].GetReadTexture();
+    SDL_GPUBuffer* bufferBinding;
+    bufferBinding = GetBricks(0);
+    BindPipeline(computePass, PipelineTypeAdvect2);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &bufferBinding, 1);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &settings.Speed, sizeof(settings.Speed));
+    DispatchIndirect(computePass, gridSize, bufferBinding, kBrickArguments * sizeof(Uint32));
+    SDL_EndGPUComputePass(computePass);
+    textures[TextureTypeDensity].Swap();
+}
+
+static void Bnd(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, int type)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUComputePass* computePass = texture.BeginReadPass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    glm::ivec3 groups = GetGroups(texture.GetSize());
+    BindPipeline(computePass, PipelineTypeBnd);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &type, sizeof(type));
+    int faceGroups = std::max({groups.x, groups.y, groups.z});
+    Dispatch(computePass, faceGroups, faceGroups, 6);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Residual(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& image, SDL_GPUTexture* rhs, ReadWriteTexture& residual, Uint32 flags, float a, float c)
 {
     DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = textures[TextureTypePressure].BeginReadPass(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBinding{};
+    readWriteTextureBinding.texture = residual.GetReadTexture();
+    SDL_GPUStorageBufferReadWriteBinding readWriteBufferBinding{};
+    readWriteBufferBinding.buffer = solverBuffer;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &readWriteTextureBinding, 1, &readWriteBufferBinding, 1);
     if (!computePass)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[2]{};
+    textureBindings[0] = rhs;
+    textureBindings[1] = image.GetReadTexture();
+    glm::ivec3 groups = GetGroups(image.GetSize());
+    BindPipeline(computePass, PipelineTypeResidual);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 2);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &flags, sizeof(flags));
+    SDL_PushGPUComputeUniformData(commandBuffer, 1, &a, sizeof(a));
+    SDL_PushGPUComputeUniformData(commandBuffer, 2, &c, sizeof(c));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Restrict(SDL_GPUCommandBuffer* commandBuffer, int level)
+{
+    DebugGroup(commandBuffer);
+    MultigridLevel& coarse = levels[level + 1];
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[2]{};
+    readWriteTextureBindings[0].texture = coarse.Rhs.GetReadTexture();
+    readWriteTextureBindings[1].texture = coarse.Pressure.GetReadTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 2, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBinding;
+    textureBinding = levels[level].Residual.GetReadTexture();
+    glm::ivec3 groups = GetGroups(coarse.Pressure.GetSize());
+    BindPipeline(computePass, PipelineTypeRestrict);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBinding, 1);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &solverBuffer, 1);
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Prolong(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& pressure, int level)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUComputePass* computePass = pressure.BeginReadPass(commandBuffer);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBinding;
+    textureBinding = levels[level + 1].Pressure.GetReadTexture();
+    glm::ivec3 groups = GetGroups(pressure.GetSize());
+    BindPipeline(computePass, PipelineTypeProlong);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBinding, 1);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &solverBuffer, 1);
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Solver(SDL_GPUCommandBuffer* commandBuffer, Uint32 mode, float tolerance = 0.0f, Uint32 step = 0, Uint32 solve = 0)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageBufferReadWriteBinding readWriteBufferBinding{};
+    readWriteBufferBinding.buffer = solverBuffer;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, nullptr, 0, &readWriteBufferBinding, 1);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    BindPipeline(computePass, PipelineTypeSolver);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &mode, sizeof(mode));
+    SDL_PushGPUComputeUniformData(commandBuffer, 1, &tolerance, sizeof(tolerance));
+    SDL_PushGPUComputeUniformData(commandBuffer, 2, &step, sizeof(step));
+    SDL_PushGPUComputeUniformData(commandBuffer, 3, &solve, sizeof(solve));
+    Dispatch(computePass, 1, 1, 1);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static int Relax(SDL_GPUCommandBuffer* commandBuffer, int level, int sweeps)
+{
+    if (settings.Tiled && sweeps >= TILE_SWEEPS)
+    {
+        Project2Tiled(commandBuffer, GetPressure(level), GetRhs(level));
+        return TILE_SWEEPS;
+    }
+    Project2(commandBuffer, level, 0);
+    Project2(commandBuffer, level, 1);
+    Bnd(commandBuffer, GetPressure(level), 0);
+    return 1;
+}
+
+static void Smooth(SDL_GPUCommandBuffer* commandBuffer, int level, int sweeps)
+{
+    for (int i = 0; i < sweeps;)
+    {
+        i += Relax(commandBuffer, level, sweeps - i);
+    }
+}
+
+static int GetCheckStep(int iteration, int& unchecked, int sweeps)
+{
+    unchecked += sweeps;
+    if (!settings.Adaptive || (unchecked < settings.CheckInterval && iteration < settings.Iterations))
+    {
+        return 0;
+    }
+    int step = unchecked;
+    unchecked = 0;
+    return step;
+}
+
+static void VCycle(SDL_GPUCommandBuffer* commandBuffer, int level)
+{
+    ReadWriteTexture& pressure = GetPressure(level);
+    ReadWriteTexture& rhs = GetRhs(level);
+    if (level == levelCount - 1)
+    {
+        Smooth(commandBuffer, level, kCoarseSweeps);
+        return;
+    }
+    Smooth(commandBuffer, level, kSmoothSweeps);
+    Residual(commandBuffer, pressure, rhs.GetReadTexture(), levels[level].Residual, ResidualFlagWrite, 1.0f, 6.0f);
+    Restrict(commandBuffer, level);
+    VCycle(commandBuffer, level + 1);
+    Prolong(commandBuffer, pressure, level);
+    Bnd(commandBuffer, pressure, 0);
+    Smooth(commandBuffer, level, kSmoothSweeps);
+}
+
+static void Project(SDL_GPUCommandBuffer* commandBuffer, SolveType solve)
+{
+    ReadWriteTexture& pressure = textures[TextureTypePressure];
+    ReadWriteTexture& divergence = textures[TextureTypeDivergence];
+    Project1(commandBuffer);
+    Bnd(commandBuffer, divergence, 0);
+    Bnd(commandBuffer, pressure, 0);
+    Solver(commandBuffer, SolverModeReset);
+    if (settings.PressureSolver == PressureSolverMultigrid && levelCount > 1)
+    {
+        for (int i = 0; i < settings.MaxCycles; i++)
+        {
+            VCycle(commandBuffer, 0);
+            Residual(commandBuffer, pressure, divergence.GetReadTexture(), levels[0].Residual, ResidualFlagReduce, 1.0f, 6.0f);
+            Solver(commandBuffer, SolverModeCheck, settings.PressureTolerance, 1);
+        }
+        Solver(commandBuffer, SolverModeStore, 0.0f, 0, solve);
+    }
+    else
+    {
+        for (int i = 0, unchecked = 0; i < settings.Iterations;)
+        {
+            int sweeps = Relax(commandBuffer, 0, settings.Iterations - i);
+            i += sweeps;
+            if (int step = GetCheckStep(i, unchecked, sweeps))
+            {
+                Residual(commandBuffer, pressure, divergence.GetReadTexture(), levels[0].Residual, ResidualFlagReduce, 1.0f, 6.0f);
+                Solver(commandBuffer, SolverModeCheck, settings.PressureTolerance, step);
+            }
+        }
+        if (settings.Adaptive)
+        {
+            Solver(commandBuffer, SolverModeStore, 0.0f, 0, solve);
+        }
+    }
+    Project3(commandBuffer);
+    Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
+    Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
+    Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
+}
+
+static void Copy(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, SDL_GPUTexture* scratchTexture)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTextureLocation source{};
+    source.texture = texture.GetReadTexture();
+    SDL_GPUTextureLocation destination{};
+    destination.texture = scratchTexture;
+    SDL_CopyGPUTextureToTexture(copyPass, &source, &destination, gridSize.x, gridSize.y, gridSize.z, false);
+    SDL_EndGPUCopyPass(copyPass);
+}
+
+static void Diffuse(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, float diffusion, int type, SolveType solve)
+{
+    Copy(commandBuffer, texture, scratchTextures[0]);
+    Solver(commandBuffer, SolverModeReset);
+    float a = settings.Speed * diffusion * (GetResolution() - 2) * (GetResolution() - 2);
+    float c = 1.0f + 6.0f * a;
+    for (int i = 0, unchecked = 0; i < settings.Iterations;)
+    {
+        int sweeps = 1;
+        if (settings.Tiled && settings.Iterations - i >= TILE_SWEEPS)
+        {
+            DiffuseTiled(commandBuffer, texture, scratchTextures[0], diffusion, type);
+            sweeps = TILE_SWEEPS;
+        }
+        else
+        {
+            Diffuse1(commandBuffer, texture, diffusion, 0);
+            Diffuse1(commandBuffer, texture, diffusion, 1);
+            Bnd(commandBuffer, texture, type);
+        }
+        i += sweeps;
+        if (int step = GetCheckStep(i, unchecked, sweeps))
+        {
+            Residual(commandBuffer, texture, scratchTextures[0], levels[0].Residual, ResidualFlagReduce, a, c);
+            Solver(commandBuffer, SolverModeCheck, settings.DiffuseTolerance, step);
+        }
+    }
+    if (settings.Adaptive)
+    {
+        Solver(commandBuffer, SolverModeStore, 0.0f, 0, solve);
+    }
+}
+
+static void DiffuseVelocity(SDL_GPUCommandBuffer* commandBuffer)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        Copy(commandBuffer, textures[TextureTypeVelocityX + i], scratchTextures[i]);
+    }
+    Solver(commandBuffer, SolverModeReset);
+    float a = settings.Speed * settings.Viscosity * (GetResolution() - 2) * (GetResolution() - 2);
+    float c = 1.0f + 6.0f * a;
+    for (int i = 0, unchecked = 0; i < settings.Iterations;)
+    {
+        int sweeps = 1;
+        if (settings.Tiled && settings.Iterations - i >= TILE_SWEEPS)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                DiffuseTiled(commandBuffer, textures[TextureTypeVelocityX + j], scratchTextures[j], settings.Viscosity, j + 1);
+            }
+            sweeps = TILE_SWEEPS;
+        }
+        else
+        {
+            Diffuse3(commandBuffer, settings.Viscosity, 0);
+            Diffuse3(commandBuffer, settings.Viscosity, 1);
+            Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
+            Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
+            Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
+        }
+        i += sweeps;
+        if (int step = GetCheckStep(i, unchecked, sweeps))
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                Residual(commandBuffer, textures[TextureTypeVelocityX + j], scratchTextures[j], levels[0].Residual, ResidualFlagReduce, a, c);
+            }
+            Solver(commandBuffer, SolverModeCheck, settings.DiffuseTolerance, step);
+        }
+    }
+    if (settings.Adaptive)
+    {
+        Solver(commandBuffer, SolverModeStore, 0.0f, 0, SolveTypeVelocity);
+    }
+}
+
+static void DownloadSolver(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUBufferRegion region{};
+    region.buffer = solverBuffer;
+    region.size = kSolverSize;
+    SDL_GPUTransferBufferLocation location{};
+    location.transfer_buffer = solverTransferBuffer;
+    SDL_DownloadFromGPUBuffer(copyPass, &region, &location);
+    SDL_EndGPUCopyPass(copyPass);
+}
+
+static void ReadSolver()
+{
+    Uint32* data = static_cast<Uint32*>(SDL_MapGPUTransferBuffer(device, solverTransferBuffer, false));
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return;
+    }
+    for (int i = 0; i < SolveTypeCount; i++)
+    {
+        float residual;
+        std::memcpy(&residual, &data[kSolverSolves + 2 * i + 1], sizeof(float));
+        solveIterations[i] = data[kSolverSolves + 2 * i];
+        solveResiduals[i] = residual;
+    }
+    SDL_UnmapGPUTransferBuffer(device, solverTransferBuffer);
+}
+
+static void WaitStep(bool wait)
+{
+    if (!stepFence)
+    {
+        return;
+    }
+    if (wait)
+    {
+        Uint64 begin = profiler.Begin();
+        SDL_WaitForGPUFences(device, true, &stepFence, 1);
+        profiler.End("WaitStep", begin);
+    }
+    else if (!SDL_QueryGPUFence(device, stepFence))
+    {
+        return;
+    }
+    profiler.Sample("Simulate", stepTime, SDL_GetTicksNS());
+    SDL_ReleaseGPUFence(device, stepFence);
+    stepFence = nullptr;
+    ReadSolver();
+}
+
+static void Brush(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[4]{};
+    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetReadTexture();
+    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetReadTexture();
+    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetReadTexture();
+    readWriteTextureBindings[3].texture = textures[TextureTypeDensity].GetReadTexture();
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 4, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    int extent = 2 * std::ceil(brush.Radius) + 1;
+    int groups = (extent + THREADS - 1) / THREADS;
+    BindPipeline(computePass, PipelineTypeBrush);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &brush, sizeof(brush));
+    Dispatch(computePass, groups, groups, groups);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Macrocell(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageBufferReadWriteBinding readWriteBufferBinding{};
+    readWriteBufferBinding.buffer = macrocellBuffer;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, nullptr, 0, &readWriteBufferBinding, 1);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[TextureTypeCount]{};
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        textureBindings[i] = GetRenderTexture(i);
+    }
+    glm::ivec3 groups = GetGroups(renderFrame->Size);
+    BindPipeline(computePass, PipelineTypeMacrocell);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, TextureTypeCount);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &texture, sizeof(texture));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Pack(SDL_GPUCommandBuffer* commandBuffer)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBinding{};
+    readWriteTextureBinding.texture = renderTexture;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &readWriteTextureBinding, 1, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[4]{};
+    textureBindings[0] = renderFrame->Textures[TextureTypeVelocityX];
+    textureBindings[1] = renderFrame->Textures[TextureTypeVelocityY];
+    textureBindings[2] = renderFrame->Textures[TextureTypeVelocityZ];
+    textureBindings[3] = GetRenderTexture(TextureTypeDensity);
+    glm::ivec3 groups = GetGroups(renderFrame->Size);
+    BindPipeline(computePass, PipelineTypePack);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &dyeStrength, sizeof(dyeStrength));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static void Interpolate(SDL_GPUCommandBuffer* commandBuffer, float alpha)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBinding{};
+    readWriteTextureBinding.texture = interpolatedTexture;
+    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &readWriteTextureBinding, 1, nullptr, 0);
+    if (!computePass)
+    {
+        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* textureBindings[2]{};
+    textureBindings[0] = renderFrame->Previous;
+    textureBindings[1] = renderFrame->Textures[TextureTypeDensity];
+    glm::ivec3 groups = GetGroups(renderFrame->Size);
+    BindPipeline(computePass, PipelineTypeInterpolate);
+    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 2);
+    SDL_PushGPUComputeUniformData(commandBuffer, 0, &alpha, sizeof(alpha));
+    Dispatch(computePass, groups.x, groups.y, groups.z);
+    SDL_EndGPUComputePass(computePass);
+}
+
+static int Schedule()
+{
+    Uint64 stepTime = SDL_NS_PER_SECOND / settings.StepRate;
+    int steps = std::min<Uint64>(accumulator / stepTime, settings.MaxSubsteps);
+    if (headless)
+    {
+        steps = settings.MaxSubsteps;
+        accumulator = steps * stepTime;
+    }
+    if (maxSteps)
+    {
+        Uint64 done = simulationFrame->Steps.load(std::memory_order_relaxed);
+        steps = std::min<Uint64>(steps, maxSteps - std::min<Uint64>(done, maxSteps));
+    }
+    accumulator -= steps * stepTime;
+    if (accumulator >= stepTime)
+    {
+        accumulator %= stepTime;
+    }
+    realTimeSimulated += steps * stepTime;
+    realTimeSteps += steps;
+    if (realTimeWall >= kRealTimeWindow)
+    {
+        realTimeFactor = double(realTimeSimulated) / realTimeWall;
+        stepsPerSecond = double(realTimeSteps) * SDL_NS_PER_SECOND / realTimeWall;
+        realTimeWall = 0;
+        realTimeSimulated = 0;
+        realTimeSteps = 0;
+    }
+    return steps;
+}
+
+static void Step(SDL_GPUCommandBuffer* commandBuffer, bool last)
+{
+    DebugGroup(commandBuffer);
+    if (last && settings.Interpolate)
+    {
+        Copy(commandBuffer, textures[TextureTypeDensity], simulationFrame->Previous);
+    }
+    Spawn(commandBuffer);
+    UpdateBricks(commandBuffer);
+    DiffuseVelocity(commandBuffer);
+    Project(commandBuffer, SolveTypeProject1);
+    Advect1(commandBuffer);
+    Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
+    Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
+    Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
+    Project(commandBuffer, SolveTypeProject2);
+    Diffuse(commandBuffer, textures[TextureTypeDensity], settings.Diffusion, 0, SolveTypeDensity);
+    Advect2(commandBuffer);
+    Bnd(commandBuffer, textures[TextureTypeDensity], 0);
+}
+
+static bool Reset(const std::array<int, 3>& size, const State* scene, const CheckpointHeader* checkpoint = nullptr)
+{
+    if (CreateCells({size[0], size[1], size[2]}, scene, checkpoint))
+    {
+        return true;
+    }
+    if (simulationFrame)
+    {
+        CreateCells(simulationFrame->Size, scene, nullptr);
+    }
+    return false;
+}
+
+static void ApplyScene(State& scene)
+{
+    if (!overrides.Timeline.empty())
+    {
+        scene.Timeline = overrides.Timeline;
+    }
+    ApplyParameters(scene, settings);
+    if (!overrides.Steps && scene.Steps > 0)
+    {
+        maxSteps = scene.Steps;
+    }
+    simulationSpawners = scene.Spawners;
+    simulationTimeline = scene.Timeline;
+    spawnersDirty = true;
+}
+
+static void Load(const char* path)
+{
+    State scene;
+    if (!LoadState(path, scene))
+    {
+        return;
+    }
+    if (overrides.Size[0])
+    {
+        for (Spawner& spawner : scene.Spawners)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                spawner.Position[i] = std::clamp(spawner.Position[i] * overrides.Size[i] / scene.Size[i], 1, overrides.Size[i] - 2);
+            }
+        }
+        for (TimelineEvent& event : scene.Timeline)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                event.Position[i] = event.Position[i] * overrides.Size[i] / scene.Size[i];
+            }
+        }
+        scene.Size = overrides.Size;
+    }
+    ApplyScene(scene);
+    Reset(scene.Size, &scene);
+}
+
+static bool GetFieldSize(const glm::ivec3& size, Uint32& fieldSize)
+{
+    Uint64 bytes = Uint64(size.x) * size.y * size.z * sizeof(float);
+    if (bytes * TextureTypeCount > SDL_MAX_UINT32)
+    {
+        SDL_Log("Grid too large for a checkpoint transfer buffer: %d, %d, %d", size.x, size.y, size.z);
+        return false;
+    }
+    fieldSize = Uint32(bytes);
+    return true;
+}
+
+static bool CreateCheckpointTransferBuffer(Uint32 size)
+{
+    if (size <= checkpointTransferSize)
+    {
+        return true;
+    }
+    SDL_ReleaseGPUTransferBuffer(device, checkpointTransferBuffer);
+    SDL_GPUTransferBufferCreateInfo info{};
+    info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+    info.size = size;
+    checkpointTransferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+    if (!checkpointTransferBuffer)
+    {
+        SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+        checkpointTransferSize = 0;
+        return false;
+    }
+    checkpointTransferSize = size;
+    return true;
+}
+
+static bool DownloadCheckpoint(SDL_GPUCommandBuffer* commandBuffer, Uint32 fieldSize)
+{
+    DebugGroup(commandBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return false;
+    }
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        SDL_GPUTextureRegion region{};
+        region.texture = textures[i].GetReadTexture();
+        region.w = gridSize.x;
+        region.h = gridSize.y;
+        region.d = gridSize.z;
+        SDL_GPUTextureTransferInfo info{};
+        info.transfer_buffer = checkpointTransferBuffer;
+        info.offset = i * fieldSize;
+        SDL_DownloadFromGPUTexture(copyPass, &region, &info);
+    }
+    SDL_EndGPUCopyPass(copyPass);
+    return true;
+}
+
+static void Checkpoint(const std::string& path)
+{
+    if (checkpointFence)
+    {
+        SDL_Log("Checkpoint already in progress: %s", checkpointFile.data());
+        return;
+    }
+    if (!simulationFrame)
+    {
+        return;
+    }
+    Uint32 fieldSize;
+    if (!GetFieldSize(gridSize, fieldSize) || !CreateCheckpointTransferBuffer(fieldSize * TextureTypeCount))
+    {
+        return;
+    }
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return;
+    }
+    if (!DownloadCheckpoint(commandBuffer, fieldSize))
+    {
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    checkpointFence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    checkpointFile = path;
+    checkpointHeader = {};
+    checkpointHeader.Size[0] = gridSize.x;
+    checkpointHeader.Size[1] = gridSize.y;
+    checkpointHeader.Size[2] = gridSize.z;
+    checkpointHeader.Speed = settings.Speed;
+    checkpointHeader.Diffusion = settings.Diffusion;
+    checkpointHeader.Viscosity = settings.Viscosity;
+    checkpointHeader.StepRate = settings.StepRate;
+    checkpointState.Size = {gridSize.x, gridSize.y, gridSize.z};
+    checkpointState.Spawners = simulationSpawners;
+}
+
+static void WriteCheckpoint(bool wait)
+{
+    if (!checkpointFence)
+    {
+        return;
+    }
+    if (wait)
+    {
+        SDL_WaitForGPUFences(device, true, &checkpointFence, 1);
+    }
+    else if (!SDL_QueryGPUFence(device, checkpointFence))
+    {
+        return;
+    }
+    SDL_ReleaseGPUFence(device, checkpointFence);
+    checkpointFence = nullptr;
+    void* data = SDL_MapGPUTransferBuffer(device, checkpointTransferBuffer, false);
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return;
+    }
+    SaveCheckpoint(checkpointFile.data(), checkpointHeader, checkpointState, data, compressionPool,
+        CompressionType(settings.Compression), settings.ErrorBound);
+    SDL_UnmapGPUTransferBuffer(device, checkpointTransferBuffer);
+}
+
+static void Restore(const char* path)
+{
+    CheckpointFile file;
+    State scene;
+    if (!file.Open(path) || !file.GetState(scene))
+    {
+        return;
+    }
+    const CheckpointHeader& header = file.GetHeader();
+    Uint32 fieldSize;
+    if (!GetFieldSize(glm::ivec3(scene.Size[0], scene.Size[1], scene.Size[2]), fieldSize))
+    {
+        return;
+    }
+    ApplyScene(scene);
+    if (!Reset(scene.Size, &scene, &header))
+    {
+        return;
+    }
+    SDL_GPUTransferBufferCreateInfo info{};
+    info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    info.size = fieldSize * TextureTypeCount;
+    SDL_GPUTransferBuffer* transferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+    if (!transferBuffer)
+    {
+        SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+        return;
+    }
+    void* mapped = SDL_MapGPUTransferBuffer(device, transferBuffer, false);
+    if (!mapped)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
+        return;
+    }
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        if (!file.ReadField(compressionPool, TextureType(i), reinterpret_cast<float*>(static_cast<Uint8*>(mapped) + i * fieldSize)))
+        {
+            SDL_UnmapGPUTransferBuffer(device, transferBuffer);
+            SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
+            return;
+        }
+    }
+    SDL_UnmapGPUTransferBuffer(device, transferBuffer);
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
+        return;
+    }
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
         return;
     }
-    SDL_GPUTexture* textureBinding;
-    textureBinding = textures[TextureTypeDivergence].GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    int groupsX = ((kSize + 1) / 2 + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeProject2]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBinding, 1);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &phase, sizeof(phase));
-    SDL_DispatchGPUCompute(computePass, groupsX, groups, groups);
-    SDL_EndGPUComputePass(computePass);
+    for (int i = 0; i < TextureTypeCount; i++)
+    {
+        SDL_GPUTextureTransferInfo source{};
+        source.transfer_buffer = transferBuffer;
+        source.offset = i * fieldSize;
+        SDL_GPUTextureRegion region{};
+        region.texture = textures[i].GetReadTexture();
+        region.w = gridSize.x;
+        region.h = gridSize.y;
+        region.d = gridSize.z;
+        SDL_UploadToGPUTexture(copyPass, &source, &region, false);
+    }
+    SDL_EndGPUCopyPass(copyPass);
+    CopyFrame(commandBuffer, simulationFrame);
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
 }
 
-static void Project3(SDL_GPUCommandBuffer* commandBuffer)
+static bool Measure(const char* name, const std::function<void(SDL_GPUCommandBuffer*)>& function, RooflineResult& result,
+    int repeats = kRooflineRepeats)
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[3]{};
-    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetWriteTexture();
-    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetWriteTexture();
-    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetWriteTexture();
-    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 3, nullptr, 0);
-    if (!computePass)
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        return;
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
     }
-    SDL_GPUTexture* textureBindings[4]{};
-    textureBindings[0] = textures[TextureTypePressure].GetReadTexture();
-    textureBindings[1] = textures[TextureTypeVelocityX].GetReadTexture();
-    textureBindings[2] = textures[TextureTypeVelocityY].GetReadTexture();
-    textureBindings[3] = textures[TextureTypeVelocityZ].GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeProject3]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
-    textures[TextureTypeVelocityX].Swap();
-    textures[TextureTypeVelocityY].Swap();
-    textures[TextureTypeVelocityZ].Swap();
+    Solver(commandBuffer, SolverModeReset);
+    dispatchTraffic = {};
+    for (int i = 0; i < repeats; i++)
+    {
+        function(commandBuffer);
+    }
+    result.Name = name;
+    result.Traffic = dispatchTraffic;
+    Uint64 time1 = SDL_GetTicksNS();
+    SDL_GPUFence* fence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    if (!fence)
+    {
+        SDL_Log("Failed to submit command buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_WaitForGPUFences(device, true, &fence, 1);
+    Uint64 time2 = SDL_GetTicksNS();
+    SDL_ReleaseGPUFence(device, fence);
+    result.Ms = double(time2 - time1) / SDL_NS_PER_MS;
+    return true;
 }
 
-static void Advect1(SDL_GPUCommandBuffer* commandBuffer, TextureType texture)
+static void RestoreState()
 {
-    DebugGroup(commandBuffer);
-    assert(texture == 0 || texture == 1 || texture == 2);
-    SDL_GPUComputePass* computePass = textures[texture].BeginWritePass(commandBuffer);
-    if (!computePass)
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTexture* textureBindings[3]{};
-    textureBindings[0] = textures[TextureTypeVelocityX].GetReadTexture();
-    textureBindings[1] = textures[TextureTypeVelocityY].GetReadTexture();
-    textureBindings[2] = textures[TextureTypeVelocityZ].GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeAdvect1]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 3);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &texture, sizeof(texture));
-    SDL_PushGPUComputeUniformData(commandBuffer, 1, &speed, sizeof(speed));
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
+    RestoreFrame(commandBuffer, simulationFrame);
+    UpdateBricks(commandBuffer);
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
 }
 
-static void Advect2(SDL_GPUCommandBuffer* commandBuffer)
+static void Roofline()
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = textures[TextureTypeDensity].BeginWritePass(commandBuffer);
-    if (!computePass)
+    WaitStep(true);
+    if (!simulationFrame)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTexture* textureBindings[4]{};
-    textureBindings[0] = textures[TextureTypeDensity].GetReadTexture();
-    textureBindings[1] = textures[TextureTypeVelocityX].GetReadTexture();
-    textureBindings[2] = textures[TextureTypeVelocityY].GetReadTexture();
-    textureBindings[3] = textures[TextureTypeVelocityZ].GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeAdvect2]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, textureBindings, 4);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &speed, sizeof(speed));
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
-    textures[TextureTypeDensity].Swap();
+    ReadWriteTexture& density = textures[TextureTypeDensity];
+    ReadWriteTexture& pressure = textures[TextureTypePressure];
+    ReadWriteTexture& divergence = textures[TextureTypeDivergence];
+    std::pair<const char*, std::function<void(SDL_GPUCommandBuffer*)>> kernels[] =
+    {
+        {"Occupancy", [](SDL_GPUCommandBuffer* commandBuffer) { Occupancy(commandBuffer); }},
+        {"Diffuse1", [&](SDL_GPUCommandBuffer* commandBuffer) { Diffuse1(commandBuffer, density, settings.Diffusion, 0); }},
+        {"Diffuse3", [](SDL_GPUCommandBuffer* commandBuffer) { Diffuse3(commandBuffer, settings.Viscosity, 0); }},
+        {"DiffuseTiled", [&](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            DiffuseTiled(commandBuffer, density, scratchTextures[0], settings.Diffusion, 0);
+        }},
+        {"Project1", [](SDL_GPUCommandBuffer* commandBuffer) { Project1(commandBuffer); }},
+        {"Project2", [](SDL_GPUCommandBuffer* commandBuffer) { Project2(commandBuffer, 0, 0); }},
+        {"Project2Tiled", [&](SDL_GPUCommandBuffer* commandBuffer) { Project2Tiled(commandBuffer, pressure, divergence); }},
+        {"Project3", [](SDL_GPUCommandBuffer* commandBuffer) { Project3(commandBuffer); }},
+        {"Advect1", [](SDL_GPUCommandBuffer* commandBuffer) { Advect1(commandBuffer); }},
+        {"Advect2", [](SDL_GPUCommandBuffer* commandBuffer) { Advect2(commandBuffer); }},
+        {"Bnd", [&](SDL_GPUCommandBuffer* commandBuffer) { Bnd(commandBuffer, density, 0); }},
+        {"Residual", [&](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            Residual(commandBuffer, pressure, divergence.GetReadTexture(), levels[0].Residual, ResidualFlagWrite, 1.0f, 6.0f);
+        }},
+        {"Clear", [](SDL_GPUCommandBuffer* commandBuffer) { Clear(commandBuffer, levels[0].Residual); }},
+    };
+    std::vector<RooflineResult>* results = new std::vector<RooflineResult>();
+    SDL_Log("%-14s %10s %10s %10s %10s", "Kernel", "ms", "GB/s", "GFLOP/s", "FLOP/B");
+    for (const auto& [name, function] : kernels)
+    {
+        RooflineResult result{};
+        if (!Measure(name, function, result))
+        {
+            break;
+        }
+        double bytes = result.Traffic.ReadBytes + result.Traffic.WriteBytes;
+        SDL_Log("%-14s %10.3f %10.1f %10.1f %10.2f", name, result.Ms, bytes / (result.Ms * 1e6),
+            result.Traffic.Flops / (result.Ms * 1e6), result.Traffic.Flops / std::max(bytes, 1.0));
+        results->push_back(result);
+    }
+    RestoreState();
+    delete rooflineReport.exchange(results);
 }
 
-static void Bnd1(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, int type)
+static void Phases()
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
-    if (!computePass)
+    WaitStep(true);
+    if (!simulationFrame)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTexture* textureBindings;
-    textureBindings = texture.GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBnd1]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBindings, 1);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &type, sizeof(type));
-    SDL_DispatchGPUCompute(computePass, groups, groups, 2);
-    SDL_EndGPUComputePass(computePass);
+    std::pair<const char*, std::function<void(SDL_GPUCommandBuffer*)>> phases[] =
+    {
+        {"Spawn", [](SDL_GPUCommandBuffer* commandBuffer) { Spawn(commandBuffer); }},
+        {"Bricks", [](SDL_GPUCommandBuffer* commandBuffer) { UpdateBricks(commandBuffer); }},
+        {"Diffuse", [](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            DiffuseVelocity(commandBuffer);
+            Diffuse(commandBuffer, textures[TextureTypeDensity], settings.Diffusion, 0, SolveTypeDensity);
+        }},
+        {"Project", [](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            Project(commandBuffer, SolveTypeProject1);
+            Project(commandBuffer, SolveTypeProject2);
+        }},
+        {"Advect", [](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            Advect1(commandBuffer);
+            Advect2(commandBuffer);
+        }},
+        {"Bnd", [](SDL_GPUCommandBuffer* commandBuffer)
+        {
+            Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
+            Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
+            Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
+            Bnd(commandBuffer, textures[TextureTypeDensity], 0);
+        }},
+    };
+    std::vector<RooflineResult>* results = new std::vector<RooflineResult>();
+    for (const auto& [name, function] : phases)
+    {
+        RooflineResult result{};
+        if (!Measure(name, function, result, 1))
+        {
+            break;
+        }
+        SDL_Log("%-14s %10.3f ms", name, result.Ms);
+        results->push_back(result);
+        RestoreState();
+    }
+    delete phaseReport.exchange(results);
 }
 
-static void Bnd2(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, int type)
+static void DownloadRecording(SDL_GPUCommandBuffer* commandBuffer, SDL_GPUTransferBuffer* transferBuffer)
 {
     DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
-    if (!computePass)
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTexture* textureBindings;
-    textureBindings = texture.GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBnd2]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBindings, 1);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &type, sizeof(type));
-    SDL_DispatchGPUCompute(computePass, groups, 2, groups);
-    SDL_EndGPUComputePass(computePass);
+    SDL_GPUTextureRegion region{};
+    region.texture = textures[TextureTypeDensity].GetReadTexture();
+    region.w = gridSize.x;
+    region.h = gridSize.y;
+    region.d = gridSize.z;
+    SDL_GPUTextureTransferInfo info{};
+    info.transfer_buffer = transferBuffer;
+    SDL_DownloadFromGPUTexture(copyPass, &region, &info);
+    SDL_EndGPUCopyPass(copyPass);
 }
 
-static void Bnd3(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, int type)
+static SDL_GPUCommandBuffer* Record(SDL_GPUCommandBuffer* commandBuffer)
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
-    if (!computePass)
+    simulationSteps++;
+    if (!recorder.IsOpen() || simulationSteps % settings.RecordInterval)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        return;
+        return commandBuffer;
     }
-    SDL_GPUTexture* textureBindings;
-    textureBindings = texture.GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBnd3]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBindings, 1);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &type, sizeof(type));
-    SDL_DispatchGPUCompute(computePass, 2, groups, groups);
-    SDL_EndGPUComputePass(computePass);
+    int slot;
+    SDL_GPUTransferBuffer* transferBuffer = recorder.Acquire(slot);
+    if (!transferBuffer)
+    {
+        return commandBuffer;
+    }
+    DownloadRecording(commandBuffer, transferBuffer);
+    SDL_GPUFence* fence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    recorder.Submit(slot, fence, simulationSteps);
+    commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+    }
+    return commandBuffer;
 }
 
-static void Bnd4(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture)
+// The render thread applies these to state.Spawners so UI edits and saves keep the timeline's flags
+static void PublishSpawnerEvent(const TimelineEvent& event)
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
-    if (!computePass)
+    std::vector<TimelineEvent>* events = simulationFrame->SpawnerEvents.exchange(nullptr);
+    if (!events)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        return;
+        events = new std::vector<TimelineEvent>();
     }
-    SDL_GPUTexture* textureBindings;
-    textureBindings = texture.GetReadTexture();
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBnd4]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBindings, 1);
-    SDL_DispatchGPUCompute(computePass, 1, 1, 1);
-    SDL_EndGPUComputePass(computePass);
+    events->push_back(event);
+    simulationFrame->SpawnerEvents.store(events);
 }
 
-static void Bnd5(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture)
+static void UpdateTimeline(SDL_GPUCommandBuffer* commandBuffer, Uint64 step)
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUComputePass* computePass = texture.BeginWritePass(commandBuffer);
-    if (!computePass)
+    for (; timelineIndex < simulationTimeline.size() && simulationTimeline[timelineIndex].Step <= step; timelineIndex++)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        return;
+        const TimelineEvent& event = simulationTimeline[timelineIndex];
+        switch (event.Type)
+        {
+        case TimelineEventTypeSpawnerOn:
+        case TimelineEventTypeSpawnerOff:
+            if (event.Spawner < 0 || event.Spawner >= simulationSpawners.size())
+            {
+                SDL_Log("Invalid timeline spawner: %d", event.Spawner);
+                break;
+            }
+            simulationSpawners[event.Spawner].Enabled = event.Type == TimelineEventTypeSpawnerOn;
+            spawnersDirty = true;
+            PublishSpawnerEvent(event);
+            break;
+        case TimelineEventTypeBrush:
+            brush.Position = glm::vec3(event.Position[0], event.Position[1], event.Position[2]);
+            brush.Radius = event.Radius;
+            brush.Velocity = glm::vec3(event.Velocity[0], event.Velocity[1], event.Velocity[2]);
+            brush.Dye = event.Dye;
+            Brush(commandBuffer);
+            brush.Velocity = glm::vec3(0.0f);
+            break;
+        }
     }
-    SDL_GPUTexture* textureBindings;
-    textureBindings = texture.GetReadTexture();
-    int groups = (kSize + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBnd5]);
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textureBindings, 1);
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
 }
 
-static void Bnd(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, int type)
+static void Execute(Command& command)
 {
-    Bnd1(commandBuffer, texture, type);
-    Bnd2(commandBuffer, texture, type);
-    Bnd3(commandBuffer, texture, type);
-    Bnd4(commandBuffer, texture);
-    Bnd5(commandBuffer, texture);
-    texture.Swap();
+    switch (command.Type)
+    {
+    case CommandTypeSettings:
+        settings = command.Settings;
+        break;
+    case CommandTypeSpawners:
+        simulationSpawners = std::move(command.Scene.Spawners);
+        spawnersDirty = true;
+        break;
+    case CommandTypeBrush:
+        brush.Position = command.Brush.Position;
+        brush.Radius = command.Brush.Radius;
+        brush.Velocity += command.Brush.Velocity;
+        brush.Dye = command.Brush.Dye;
+        brushPending = true;
+        break;
+    case CommandTypeReset:
+        Reset(command.Scene.Size, nullptr);
+        break;
+    case CommandTypeLoad:
+        Load(command.Path.data());
+        break;
+    case CommandTypeSave:
+        SaveState(command.Path.data(), command.Scene);
+        break;
+    case CommandTypeCheckpoint:
+        Checkpoint(command.Path);
+        break;
+    case CommandTypeRestore:
+        Restore(command.Path.data());
+        break;
+    case CommandTypeRecord:
+        recorder.Open(device, command.Path.data(), gridSize, CompressionType(settings.Compression), settings.ErrorBound);
+        break;
+    case CommandTypeStop:
+        recorder.Close();
+        break;
+    case CommandTypeRoofline:
+        Roofline();
+        break;
+    case CommandTypePhases:
+        Phases();
+        break;
+    }
 }
 
-static void Project(SDL_GPUCommandBuffer* commandBuffer)
+static void Simulate()
 {
-    Project1(commandBuffer);
-    Bnd(commandBuffer, textures[TextureTypeDivergence], 0);
-    Bnd(commandBuffer, textures[TextureTypePressure], 0);
-    for (int i = 0; i < iterations; i++)
+    profiler.SetThread(ProfilerThreadSimulation);
+    Uint64 time1 = SDL_GetTicksNS();
+    while (simulating)
     {
-        Project2(commandBuffer, 0);
-        Project2(commandBuffer, 1);
-        Bnd(commandBuffer, textures[TextureTypePressure], 0);
+        Command command;
+        while (commands.Pop(command))
+        {
+            Execute(command);
+        }
+        WriteCheckpoint(false);
+        WaitStep(false);
+        Uint64 time2 = SDL_GetTicksNS();
+        accumulator += time2 - time1;
+        realTimeWall += time2 - time1;
+        time1 = time2;
+        int steps = simulationFrame ? Schedule() : 0;
+        if (!steps)
+        {
+            SDL_DelayNS(kIdleDelay);
+            continue;
+        }
+        SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+        if (!commandBuffer)
+        {
+            SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+            continue;
+        }
+        profiler.BeginFrame();
+        if (brushPending)
+        {
+            Brush(commandBuffer);
+            brush.Velocity = glm::vec3(0.0f);
+            brushPending = false;
+        }
+        Uint64 done = simulationFrame->Steps.load(std::memory_order_relaxed);
+        for (int i = 0; i < steps && commandBuffer; i++)
+        {
+            UpdateTimeline(commandBuffer, done + i);
+            Step(commandBuffer, i == steps - 1);
+            commandBuffer = Record(commandBuffer);
+        }
+        if (!commandBuffer)
+        {
+            continue;
+        }
+        CopyFrame(commandBuffer, simulationFrame);
+        DownloadSolver(commandBuffer);
+        WaitStep(true);
+        Uint64 begin = profiler.Begin();
+        stepTime = SDL_GetTicksNS();
+        stepFence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+        profiler.End("Submit", begin);
+        if (!outputPath.empty() && outputCheckpoint && maxSteps && done + steps == maxSteps)
+        {
+            Checkpoint((std::filesystem::path(outputPath) / "final.ckpt").string());
+        }
+        simulationFrame->Time.store(time2 - accumulator, std::memory_order_relaxed);
+        simulationFrame->Interpolated.store(settings.Interpolate, std::memory_order_relaxed);
+        simulationFrame->Steps.fetch_add(steps, std::memory_order_release);
     }
-    Project3(commandBuffer);
-    Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
-    Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
-    Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
+    WaitStep(true);
+    WriteCheckpoint(true);
+    recorder.Close();
 }
 
-static void Diffuse(SDL_GPUCommandBuffer* commandBuffer, ReadWriteTexture& texture, float diffusion, int type)
+static void UpdateRender(SDL_GPUCommandBuffer* commandBuffer)
 {
-    DebugGroup(commandBuffer);
-    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
-    if (!copyPass)
+    if (!renderDirty && renderType == texture && renderDyeStrength == dyeStrength)
     {
-        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTextureLocation source{};
-    source.texture = texture.GetReadTexture();
-    SDL_GPUTextureLocation destination{};
-    destination.texture = scratchTexture;
-    SDL_CopyGPUTextureToTexture(copyPass, &source, &destination, kSize, kSize, kSize, false);
-    SDL_EndGPUCopyPass(copyPass);
-    for (int i = 0; i < iterations; i++)
-    {
-        Diffuse1(commandBuffer, texture, diffusion, 0);
-        Diffuse1(commandBuffer, texture, diffusion, 1);
-        Bnd(commandBuffer, texture, type);
-    }
-}
-
-static void Brush(SDL_GPUCommandBuffer* commandBuffer)
-{
-    DebugGroup(commandBuffer);
-    SDL_GPUStorageTextureReadWriteBinding readWriteTextureBindings[4]{};
-    readWriteTextureBindings[0].texture = textures[TextureTypeVelocityX].GetReadTexture();
-    readWriteTextureBindings[1].texture = textures[TextureTypeVelocityY].GetReadTexture();
-    readWriteTextureBindings[2].texture = textures[TextureTypeVelocityZ].GetReadTexture();
-    readWriteTextureBindings[3].texture = textures[TextureTypeDensity].GetReadTexture();
-    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, readWriteTextureBindings, 4, nullptr, 0);
-    if (!computePass)
+    Macrocell(commandBuffer);
+    if (texture == TextureTypeCount)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        return;
+        Pack(commandBuffer);
     }
-    BrushUniformBuffer uniform{};
-    uniform.Position = brushPosition;
-    uniform.Radius = brushRadius;
-    uniform.Velocity = brushVelocity;
-    uniform.Dye = brushDye;
-    int extent = 2 * std::ceil(brushRadius) + 1;
-    int groups = (extent + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeBrush]);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &uniform, sizeof(uniform));
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
+    renderDirty = false;
+    renderType = texture;
+    renderDyeStrength = dyeStrength;
 }
 
 static void Render(SDL_GPUCommandBuffer* commandBuffer)
@@ -866,12 +3288,14 @@ static void Render(SDL_GPUCommandBuffer* commandBuffer)
         SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
         return;
     }
-    SDL_GPUTextureSamplerBinding textureBindings[TextureTypeCount]{};
+    SDL_GPUTextureSamplerBinding textureBindings[TextureTypeCount + 1]{};
     for (int i = 0; i < TextureTypeCount; i++)
     {
         textureBindings[i].sampler = sampler;
-        textureBindings[i].texture = textures[i].GetReadTexture();
+        textureBindings[i].texture = GetRenderTexture(i);
     }
+    textureBindings[TextureTypeCount].sampler = sampler;
+    textureBindings[TextureTypeCount].texture = renderTexture;
     RaymarchUniformBuffer uniform{};
     uniform.InverseView = inverseView;
     uniform.InverseProj = inverseProj;
@@ -880,10 +3304,11 @@ static void Render(SDL_GPUCommandBuffer* commandBuffer)
     uniform.Type = texture;
     int groupsX = (colorWidth + THREADS - 1) / THREADS;
     int groupsY = (colorHeight + THREADS - 1) / THREADS;
-    SDL_BindGPUComputePipeline(computePass, pipelines[PipelineTypeRaymarch]);
-    SDL_BindGPUComputeSamplers(computePass, 0, textureBindings, TextureTypeCount);
+    BindPipeline(computePass, PipelineTypeRaymarch);
+    SDL_BindGPUComputeSamplers(computePass, 0, textureBindings, TextureTypeCount + 1);
+    SDL_BindGPUComputeStorageBuffers(computePass, 0, &macrocellBuffer, 1);
     SDL_PushGPUComputeUniformData(commandBuffer, 0, &uniform, sizeof(uniform));
-    SDL_DispatchGPUCompute(computePass, groupsX, groupsY, 1);
+    Dispatch(computePass, groupsX, groupsY, 1);
     SDL_EndGPUComputePass(computePass);
 }
 
@@ -918,8 +3343,83 @@ static void RenderImGui(SDL_GPUCommandBuffer* commandBuffer, SDL_GPUTexture* swa
     SDL_EndGPURenderPass(renderPass);
 }
 
+static void WaitRender(bool wait)
+{
+    if (!renderFence)
+    {
+        return;
+    }
+    if (wait)
+    {
+        SDL_WaitForGPUFences(device, true, &renderFence, 1);
+    }
+    else if (!SDL_QueryGPUFence(device, renderFence))
+    {
+        return;
+    }
+    profiler.Sample("Update", renderTime, SDL_GetTicksNS());
+    SDL_ReleaseGPUFence(device, renderFence);
+    renderFence = nullptr;
+}
+
+static bool UpdateHeadless()
+{
+    profiler.BeginFrame();
+    SendCommands();
+    if (!UpdateFrame())
+    {
+        SDL_DelayNS(kIdleDelay);
+        return true;
+    }
+    if (!headlessTime && (renderSteps >= warmupSteps || (maxSteps && renderSteps >= maxSteps)))
+    {
+        headlessTime = SDL_GetTicksNS();
+        headlessSteps = renderSteps;
+    }
+    if (!traceFile.empty() && !profiler.IsCapturing())
+    {
+        profiler.WriteCapture(traceFile.data());
+        traceFile.clear();
+    }
+    if (maxSteps && renderSteps >= maxSteps)
+    {
+        Uint64 steps = renderSteps - headlessSteps;
+        if (!phasesSent)
+        {
+            headlessSeconds = double(SDL_GetTicksNS() - headlessTime) / SDL_NS_PER_SECOND;
+            SDL_Log("Steps: %" SDL_PRIu64 ", Time: %.3f s, Steps: %.1f/s", steps, headlessSeconds, steps / headlessSeconds);
+            if (outputPath.empty())
+            {
+                return false;
+            }
+            Command command{};
+            command.Type = CommandTypePhases;
+            Send(std::move(command));
+            phasesSent = true;
+        }
+        std::vector<RooflineResult>* phases = phaseReport.exchange(nullptr);
+        if (!phases)
+        {
+            SDL_DelayNS(kIdleDelay);
+            return true;
+        }
+        WriteOutput(headlessSeconds, steps, *phases);
+        delete phases;
+        return false;
+    }
+    SDL_DelayNS(kIdleDelay);
+    return true;
+}
+
 static void Update()
 {
+    profiler.BeginFrame();
+    Profile(profiler);
+    WaitRender(false);
+    if (!UpdateFrame())
+    {
+        return;
+    }
     SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
     if (!commandBuffer)
     {
@@ -927,7 +3427,10 @@ static void Update()
         return;
     }
     SDL_GPUTexture* swapchainTexture;
-    if (!SDL_WaitAndAcquireGPUSwapchainTexture(commandBuffer, window, &swapchainTexture, &swapchainWidth, &swapchainHeight))
+    Uint64 begin = profiler.Begin();
+    bool acquired = SDL_WaitAndAcquireGPUSwapchainTexture(commandBuffer, window, &swapchainTexture, &swapchainWidth, &swapchainHeight);
+    profiler.End("Swapchain", begin);
+    if (!acquired)
     {
         SDL_Log("Failed to acquire swapchain texture: %s", SDL_GetError());
         SDL_CancelGPUCommandBuffer(commandBuffer);
@@ -945,41 +3448,45 @@ static void Update()
     }
     UpdateImGui(commandBuffer);
     UpdateViewProj();
-    if (brushActive)
+    SendCommands();
+    if (IsInterpolating())
     {
-        Brush(commandBuffer);
-        brushVelocity = glm::vec3(0.0f);
-        brushActive = false;
-    }
-    if (cooldown <= 0)
-    {
-        Diffuse(commandBuffer, textures[TextureTypeVelocityX], viscosity, 1);
-        Diffuse(commandBuffer, textures[TextureTypeVelocityY], viscosity, 2);
-        Diffuse(commandBuffer, textures[TextureTypeVelocityZ], viscosity, 3);
-        Project(commandBuffer);
-        Advect1(commandBuffer, TextureTypeVelocityX);
-        Advect1(commandBuffer, TextureTypeVelocityY);
-        Advect1(commandBuffer, TextureTypeVelocityZ);
-        textures[TextureTypeVelocityX].Swap();
-        textures[TextureTypeVelocityY].Swap();
-        textures[TextureTypeVelocityZ].Swap();
-        Bnd(commandBuffer, textures[TextureTypeVelocityX], 1);
-        Bnd(commandBuffer, textures[TextureTypeVelocityY], 2);
-        Bnd(commandBuffer, textures[TextureTypeVelocityZ], 3);
-        Project(commandBuffer);
-        Diffuse(commandBuffer, textures[TextureTypeDensity], diffusion, 0);
-        Advect2(commandBuffer);
-        Bnd(commandBuffer, textures[TextureTypeDensity], 0);
-        cooldown = kCooldown;
+        Uint64 stepTime = SDL_NS_PER_SECOND / newSettings.StepRate;
+        Uint64 elapsed = SDL_GetTicksNS() - renderFrame->Time.load(std::memory_order_relaxed);
+        Interpolate(commandBuffer, std::min(float(elapsed) / stepTime, 1.0f));
+        renderDirty = true;
     }
+    UpdateRender(commandBuffer);
     Render(commandBuffer);
     Blit(commandBuffer, swapchainTexture);
     RenderImGui(commandBuffer, swapchainTexture);
-    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    begin = profiler.Begin();
+    if (renderFence)
+    {
+        SDL_SubmitGPUCommandBuffer(commandBuffer);
+    }
+    else
+    {
+        renderTime = SDL_GetTicksNS();
+        renderFence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    }
+    profiler.End("Submit", begin);
+    if (!traceFile.empty() && !profiler.IsCapturing())
+    {
+        profiler.WriteCapture(traceFile.data());
+        traceFile.clear();
+    }
 }
 
 int main(int argc, char** argv)
 {
+    if (!ParseArgs(argc, argv))
+    {
+        SDL_Log("Usage: %s [scene.json|checkpoint.ckpt] [--headless] [--steps N] [--size N] [--iterations N] "
+            "[--viscosity F] [--diffusion F] [--dt F] [--timeline FILE] [--output DIR] [--no-checkpoint] [--warmup N] "
+            "[--multigrid] [--adaptive] [--tiled] [--sparse] [--trace FILE] [--trace-frames N]", argv[0]);
+        return 1;
+    }
     if (!Init())
     {
         SDL_Log("Failed to initialize");
@@ -995,34 +3502,57 @@ int main(int argc, char** argv)
         SDL_Log("Failed to create samplers");
         return 1;
     }
-    if (argc > 1)
+    if (!CreateBuffers())
     {
-        LoadCallback(nullptr, argv + 1, 0);
+        SDL_Log("Failed to create buffers");
+        return 1;
     }
-    if (!CreateCells())
+    std::error_code error;
+    if (!outputPath.empty() && !std::filesystem::create_directories(outputPath, error) && error)
     {
-        SDL_Log("Failed to create cells");
+        SDL_Log("Failed to create directory: %s, %s", outputPath.data(), error.message().data());
         return 1;
     }
+    if (overrides.Size[0])
+    {
+        state.Size = overrides.Size;
+    }
+    ApplyParameters(overrides, newSettings);
+    settings = newSettings;
+    sentSettings = newSettings;
+    simulationTimeline = overrides.Timeline;
+    SendReset();
+    if (!scenePath.empty())
+    {
+        SendLoad(scenePath.data());
+    }
+    if (!traceFile.empty())
+    {
+        profiler.SetCaptureThread(headless ? ProfilerThreadSimulation : ProfilerThreadRender);
+        profiler.StartCapture(traceFrames);
+    }
+    compressionPool.Create(0);
+    simulating = true;
+    simulationThread = std::thread(Simulate);
     bool running = true;
     while (running)
     {
-        time2 = SDL_GetTicks();
-        float deltaTime = time2 - time1;
-        cooldown -= deltaTime;
-        time1 = time2;
         SDL_Event event;
         while (SDL_PollEvent(&event))
         {
-            ImGui_ImplSDL3_ProcessEvent(&event);
             if (event.type == SDL_EVENT_QUIT)
             {
                 running = false;
                 break;
             }
+            if (headless)
+            {
+                continue;
+            }
+            ImGui_ImplSDL3_ProcessEvent(&event);
             if (event.type == SDL_EVENT_DROP_FILE)
             {
-                LoadCallback(nullptr, &event.drop.data, 0);
+                SendLoad(event.drop.data);
                 continue;
             }
             const ImGuiIO& io = ImGui::GetIO();
@@ -1051,8 +3581,7 @@ int main(int argc, char** argv)
             case SDL_EVENT_KEY_DOWN:
                 if (event.key.scancode == SDL_SCANCODE_R)
                 {
-                    std::lock_guard lock(mutex);
-                    CreateCells();
+                    SendReset();
                 }
                 break;
             }
@@ -1061,27 +3590,76 @@ int main(int argc, char** argv)
         {
             break;
         }
-        std::lock_guard lock(mutex);
-        Update();
+        if (headless)
+        {
+            running = UpdateHeadless();
+        }
+        else
+        {
+            Update();
+        }
+    }
+    if (window)
+    {
+        SDL_HideWindow(window);
+    }
+    simulating = false;
+    simulationThread.join();
+    WaitRender(true);
+    Frame* frame;
+    while (frames.Pop(frame))
+    {
+        FreeFrame(renderFrame);
+        renderFrame = frame;
     }
-    SDL_HideWindow(window);
+    FreeFrame(renderFrame);
+    delete savePath.exchange(nullptr);
+    delete loadPath.exchange(nullptr);
+    delete checkpointPath.exchange(nullptr);
+    delete tracePath.exchange(nullptr);
+    delete rooflineReport.exchange(nullptr);
+    delete phaseReport.exchange(nullptr);
     for (int i = 0; i < TextureTypeCount; i++)
     {
         textures[i].Free(device);
     }
-    SDL_ReleaseGPUTexture(device, scratchTexture);
+    for (int i = 0; i < kMaxLevels; i++)
+    {
+        levels[i].Pressure.Free(device);
+        levels[i].Rhs.Free(device);
+        levels[i].Residual.Free(device);
+        SDL_ReleaseGPUBuffer(device, levels[i].Bricks);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        SDL_ReleaseGPUTexture(device, scratchTextures[i]);
+    }
+    SDL_ReleaseGPUTexture(device, renderTexture);
+    SDL_ReleaseGPUTexture(device, interpolatedTexture);
     SDL_ReleaseGPUTexture(device, colorTexture);
     SDL_ReleaseGPUSampler(device, sampler);
+    SDL_ReleaseGPUBuffer(device, solverBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, solverTransferBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, checkpointTransferBuffer);
+    SDL_ReleaseGPUBuffer(device, spawnerBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, spawnerTransferBuffer);
+    SDL_ReleaseGPUBuffer(device, occupancyBuffer);
+    SDL_ReleaseGPUBuffer(device, activeBricksBuffer);
+    SDL_ReleaseGPUBuffer(device, clearBricksBuffer);
+    SDL_ReleaseGPUBuffer(device, macrocellBuffer);
     for (int i = 0; i < PipelineTypeCount; i++)
     {
         SDL_ReleaseGPUComputePipeline(device, pipelines[i]);
     }
-    ImGui_ImplSDLGPU3_Shutdown();
-    ImGui_ImplSDL3_Shutdown();
-    ImGui::DestroyContext();
-    SDL_ReleaseWindowFromGPUDevice(device, window);
+    if (!headless)
+    {
+        ImGui_ImplSDLGPU3_Shutdown();
+        ImGui_ImplSDL3_Shutdown();
+        ImGui::DestroyContext();
+        SDL_ReleaseWindowFromGPUDevice(device, window);
+    }
     SDL_DestroyGPUDevice(device);
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;
-}
+}
\ No newline at end of file
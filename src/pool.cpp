@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "pool.hpp"
+
+ThreadPool::~ThreadPool()
+{
+    Free();
+}
+
+void ThreadPool::Create(int threads)
+{
+    Free();
+    if (threads <= 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Stopping = false;
+    for (int i = 1; i < threads; i++)
+    {
+        Threads.emplace_back(&ThreadPool::Run, this, i);
+    }
+}
+
+void ThreadPool::Free()
+{
+    {
+        std::lock_guard lock(Mutex);
+        Stopping = true;
+    }
+    StartCondition.notify_all();
+    for (std::thread& thread : Threads)
+    {
+        thread.join();
+    }
+    Threads.clear();
+}
+
+void ThreadPool::For(int begin, int end, const std::function<void(int begin, int end)>& function)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    if (Threads.empty())
+    {
+        function(begin, end);
+        return;
+    }
+    {
+        std::lock_guard lock(Mutex);
+        Function = &function;
+        Begin = begin;
+        End = end;
+        Remaining = Threads.size();
+        Generation++;
+    }
+    StartCondition.notify_all();
+    int chunkBegin;
+    int chunkEnd;
+    Chunk(0, chunkBegin, chunkEnd);
+    if (chunkBegin < chunkEnd)
+    {
+        function(chunkBegin, chunkEnd);
+    }
+    std::unique_lock lock(Mutex);
+    DoneCondition.wait(lock, [this] { return Remaining == 0; });
+    Function = nullptr;
+}
+
+int ThreadPool::GetThreads() const
+{
+    return Threads.size() + 1;
+}
+
+void ThreadPool::Run(int index)
+{
+    uint64_t generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(Mutex);
+            StartCondition.wait(lock, [&] { return Stopping || Generation != generation; });
+            if (Stopping)
+            {
+                return;
+            }
+            generation = Generation;
+        }
+        int chunkBegin;
+        int chunkEnd;
+        Chunk(index, chunkBegin, chunkEnd);
+        if (chunkBegin < chunkEnd)
+        {
+            (*Function)(chunkBegin, chunkEnd);
+        }
+        {
+            std::lock_guard lock(Mutex);
+            Remaining--;
+        }
+        DoneCondition.notify_one();
+    }
+}
+
+void ThreadPool::Chunk(int index, int& begin, int& end) const
+{
+    int threads = GetThreads();
+    int count = End - Begin;
+    begin = Begin + count * index / threads;
+    end = Begin + count * (index + 1) / threads;
+}
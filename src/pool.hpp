@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    ThreadPool() : Function{}, Begin{}, End{}, Generation{}, Remaining{}, Stopping{} {}
+    ~ThreadPool();
+    void Create(int threads);
+    void Free();
+    void For(int begin, int end, const std::function<void(int begin, int end)>& function);
+    int GetThreads() const;
+
+private:
+    void Run(int index);
+    void Chunk(int index, int& begin, int& end) const;
+
+    std::vector<std::thread> Threads;
+    std::mutex Mutex;
+    std::condition_variable StartCondition;
+    std::condition_variable DoneCondition;
+    const std::function<void(int, int)>* Function;
+    int Begin;
+    int End;
+    uint64_t Generation;
+    int Remaining;
+    bool Stopping;
+};
@@ -0,0 +1,264 @@
+#include <SDL3/SDL.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "profiler.hpp"
+
+static constexpr float kPercentiles[ProfilerPercentileCount] = {0.50f, 0.95f, 0.99f};
+static constexpr const char* kThreads[ProfilerThreadCount] = {"Render", "Simulation"};
+
+thread_local int Profiler::Thread = ProfilerThreadRender;
+thread_local int Profiler::Depth;
+thread_local std::array<ProfilerEvent, Profiler::kMaxDepth> Profiler::Stack;
+
+void Profiler::SetThread(ProfilerThread thread)
+{
+    Thread = thread;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    Enabled = enabled;
+}
+
+bool Profiler::IsEnabled() const
+{
+    return Enabled;
+}
+
+bool Profiler::IsActive() const
+{
+    return Enabled || CaptureFrames > 0;
+}
+
+void Profiler::BeginFrame()
+{
+    Uint64 time = SDL_GetTicksNS();
+    if (Thread == CaptureThread && CaptureFrames > 0)
+    {
+        CaptureFrames--;
+    }
+    std::lock_guard lock(Mutex);
+    ProfilerFrame& current = Current[Thread];
+    if (current.Begin)
+    {
+        current.End = time;
+        std::swap(Frames[Thread], current);
+    }
+    current.Begin = Enabled ? time : 0;
+    current.End = 0;
+    current.Events.clear();
+}
+
+Uint64 Profiler::Begin()
+{
+    if (Depth < kMaxDepth)
+    {
+        Stack[Depth] = {};
+    }
+    Depth++;
+    return IsActive() ? SDL_GetTicksNS() : 0;
+}
+
+void Profiler::End(const char* name, Uint64 begin)
+{
+    Depth--;
+    if (!IsActive() || !begin)
+    {
+        return;
+    }
+    ProfilerEvent event{};
+    if (Depth < kMaxDepth)
+    {
+        event = Stack[Depth];
+    }
+    event.Name = name;
+    event.Thread = Thread;
+    event.Depth = Depth;
+    event.Begin = begin;
+    event.End = SDL_GetTicksNS();
+    std::lock_guard lock(Mutex);
+    Add(name, false, event.End - event.Begin);
+    if (Current[Thread].Begin)
+    {
+        Current[Thread].Events.push_back(event);
+    }
+    if (CaptureFrames > 0)
+    {
+        Capture.push_back(event);
+    }
+}
+
+void Profiler::Sample(const char* name, Uint64 begin, Uint64 end)
+{
+    if (!IsActive() || !begin)
+    {
+        return;
+    }
+    std::lock_guard lock(Mutex);
+    Add(name, true, end - begin);
+    if (CaptureFrames > 0)
+    {
+        ProfilerEvent event{};
+        event.Name = name;
+        event.Thread = Thread;
+        event.Gpu = true;
+        event.Begin = begin;
+        event.End = end;
+        Capture.push_back(event);
+    }
+}
+
+void Profiler::Dispatch(Uint32 groupsX, Uint32 groupsY, Uint32 groupsZ, Uint64 bytes)
+{
+    if (!Depth || Depth > kMaxDepth)
+    {
+        return;
+    }
+    ProfilerEvent& event = Stack[Depth - 1];
+    event.Dispatches++;
+    event.Groups[0] = groupsX;
+    event.Groups[1] = groupsY;
+    event.Groups[2] = groupsZ;
+    event.Bytes += bytes;
+}
+
+void Profiler::SetCaptureThread(ProfilerThread thread)
+{
+    CaptureThread = thread;
+}
+
+void Profiler::StartCapture(int frames)
+{
+    std::lock_guard lock(Mutex);
+    Capture.clear();
+    CaptureFrames = frames;
+}
+
+bool Profiler::IsCapturing() const
+{
+    return CaptureFrames > 0;
+}
+
+bool Profiler::WriteCapture(const char* path)
+{
+    std::vector<ProfilerEvent> events;
+    {
+        std::lock_guard lock(Mutex);
+        events.swap(Capture);
+    }
+    Uint64 origin = UINT64_MAX;
+    for (const ProfilerEvent& event : events)
+    {
+        origin = std::min(origin, event.Begin);
+    }
+    nlohmann::ordered_json trace;
+    trace["displayTimeUnit"] = "ms";
+    trace["traceEvents"] = nlohmann::ordered_json::array();
+    for (int i = 0; i < 2 * ProfilerThreadCount; i++)
+    {
+        nlohmann::ordered_json metadata;
+        metadata["name"] = "thread_name";
+        metadata["ph"] = "M";
+        metadata["pid"] = 0;
+        metadata["tid"] = i;
+        metadata["args"]["name"] = std::string(kThreads[i % ProfilerThreadCount]) + (i >= ProfilerThreadCount ? " (GPU)" : "");
+        trace["traceEvents"].push_back(metadata);
+    }
+    for (const ProfilerEvent& event : events)
+    {
+        nlohmann::ordered_json output;
+        output["name"] = event.Name;
+        output["cat"] = event.Gpu ? "gpu" : "cpu";
+        output["ph"] = "X";
+        output["pid"] = 0;
+        output["tid"] = event.Thread + (event.Gpu ? ProfilerThreadCount : 0);
+        output["ts"] = double(event.Begin - origin) / SDL_NS_PER_US;
+        output["dur"] = double(event.End - event.Begin) / SDL_NS_PER_US;
+        if (event.Dispatches)
+        {
+            output["args"]["Dispatches"] = event.Dispatches;
+            output["args"]["Groups"] = event.Groups;
+            output["args"]["Bytes"] = event.Bytes;
+        }
+        trace["traceEvents"].push_back(output);
+    }
+    std::ofstream file(path);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    try
+    {
+        file << trace.dump();
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to save json: %s, %s", path, exception.what());
+        return false;
+    }
+    SDL_Log("Wrote trace: %s, %zu events", path, events.size());
+    return true;
+}
+
+void Profiler::Add(const char* name, bool gpu, Uint64 time)
+{
+    auto zone = std::find_if(Zones.begin(), Zones.end(), [&](const Zone& zone)
+    {
+        return zone.Thread == Thread && zone.Gpu == gpu && (zone.Name == name || !std::strcmp(zone.Name, name));
+    });
+    if (zone == Zones.end())
+    {
+        zone = Zones.insert(Zones.end(), {name, Thread, gpu, 0, {}});
+    }
+    zone->Samples[zone->Count % kSamples] = time;
+    zone->Count++;
+}
+
+void Profiler::GetZones(std::vector<ProfilerZone>& zones)
+{
+    zones.clear();
+    std::vector<Uint64> samples;
+    std::lock_guard lock(Mutex);
+    for (const Zone& zone : Zones)
+    {
+        ProfilerZone& output = zones.emplace_back();
+        output.Name = zone.Name;
+        output.Thread = zone.Thread;
+        output.Gpu = zone.Gpu;
+        output.Count = zone.Count;
+        samples.assign(zone.Samples.begin(), zone.Samples.begin() + std::min<Uint64>(zone.Count, kSamples));
+        std::sort(samples.begin(), samples.end());
+        for (int i = 0; i < ProfilerPercentileCount; i++)
+        {
+            Uint64 sample = samples[std::min<size_t>(kPercentiles[i] * samples.size(), samples.size() - 1)];
+            output.Percentiles[i] = float(sample) / SDL_NS_PER_MS;
+        }
+    }
+}
+
+void Profiler::GetFrame(ProfilerThread thread, ProfilerFrame& frame)
+{
+    std::lock_guard lock(Mutex);
+    frame = Frames[thread];
+}
+
+ProfilerScope::ProfilerScope(Profiler& profiler, const char* name)
+    : Owner{profiler}
+    , Name{name}
+    , Begin{profiler.Begin()}
+{
+}
+
+ProfilerScope::~ProfilerScope()
+{
+    Owner.End(Name, Begin);
+}
\ No newline at end of file
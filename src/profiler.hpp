@@ -0,0 +1,114 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#define Profile(profiler) ProfilerScope profilerScope(profiler, SDL_FUNCTION)
+
+enum ProfilerThread
+{
+    ProfilerThreadRender,
+    ProfilerThreadSimulation,
+    ProfilerThreadCount,
+};
+
+enum ProfilerPercentile
+{
+    ProfilerPercentile50,
+    ProfilerPercentile95,
+    ProfilerPercentile99,
+    ProfilerPercentileCount,
+};
+
+struct ProfilerEvent
+{
+    const char* Name;
+    int Thread;
+    int Depth;
+    bool Gpu;
+    Uint64 Begin;
+    Uint64 End;
+    int Dispatches;
+    Uint32 Groups[3];
+    Uint64 Bytes;
+};
+
+struct ProfilerZone
+{
+    const char* Name;
+    int Thread;
+    bool Gpu;
+    Uint64 Count;
+    float Percentiles[ProfilerPercentileCount];
+};
+
+struct ProfilerFrame
+{
+    Uint64 Begin;
+    Uint64 End;
+    std::vector<ProfilerEvent> Events;
+};
+
+class Profiler
+{
+public:
+    Profiler() : Zones{}, Current{}, Frames{}, Capture{}, CaptureFrames{}, CaptureThread{ProfilerThreadRender}, Enabled{} {}
+    void SetThread(ProfilerThread thread);
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const;
+    void BeginFrame();
+    Uint64 Begin();
+    void End(const char* name, Uint64 begin);
+    void Sample(const char* name, Uint64 begin, Uint64 end);
+    void Dispatch(Uint32 groupsX, Uint32 groupsY, Uint32 groupsZ, Uint64 bytes);
+    void SetCaptureThread(ProfilerThread thread);
+    void StartCapture(int frames);
+    bool IsCapturing() const;
+    bool WriteCapture(const char* path);
+    void GetZones(std::vector<ProfilerZone>& zones);
+    void GetFrame(ProfilerThread thread, ProfilerFrame& frame);
+
+    static constexpr int kSamples = 256;
+    static constexpr int kMaxDepth = 16;
+
+private:
+    struct Zone
+    {
+        const char* Name;
+        int Thread;
+        bool Gpu;
+        Uint64 Count;
+        std::array<Uint64, kSamples> Samples;
+    };
+
+    bool IsActive() const;
+    void Add(const char* name, bool gpu, Uint64 time);
+
+    std::mutex Mutex;
+    std::vector<Zone> Zones;
+    ProfilerFrame Current[ProfilerThreadCount];
+    ProfilerFrame Frames[ProfilerThreadCount];
+    std::vector<ProfilerEvent> Capture;
+    std::atomic<int> CaptureFrames;
+    std::atomic<int> CaptureThread;
+    std::atomic<bool> Enabled;
+    static thread_local int Thread;
+    static thread_local int Depth;
+    static thread_local std::array<ProfilerEvent, kMaxDepth> Stack;
+};
+
+class ProfilerScope
+{
+public:
+    ProfilerScope(Profiler& profiler, const char* name);
+    ~ProfilerScope();
+
+private:
+    Profiler& Owner;
+    const char* Name;
+    Uint64 Begin;
+};
\ No newline at end of file
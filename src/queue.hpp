@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+template <typename T, int N>
+class SpscQueue
+{
+public:
+    SpscQueue() : Items{}, Head{}, Tail{} {}
+    bool Push(T&& item);
+    bool Pop(T& item);
+
+private:
+    std::array<T, N> Items;
+    alignas(64) std::atomic<int> Head;
+    alignas(64) std::atomic<int> Tail;
+};
+
+template <typename T, int N>
+bool SpscQueue<T, N>::Push(T&& item)
+{
+    int tail = Tail.load(std::memory_order_relaxed);
+    int next = (tail + 1) % N;
+    if (next == Head.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    Items[tail] = std::move(item);
+    Tail.store(next, std::memory_order_release);
+    return true;
+}
+
+template <typename T, int N>
+bool SpscQueue<T, N>::Pop(T& item)
+{
+    int head = Head.load(std::memory_order_relaxed);
+    if (head == Tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    item = std::move(Items[head]);
+    Head.store((head + 1) % N, std::memory_order_release);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "compress.hpp"
+#include "recorder.hpp"
+
+static constexpr char kMagic[4] = {'F', 'S', 'R', 'C'};
+static constexpr Uint32 kVersion = 2;
+
+Recorder::Recorder()
+    : Device{}
+    , TransferBuffers{}
+    , Available{0}
+    , Size{}
+    , Compression{}
+    , ErrorBound{}
+    , Opened{}
+    , Written{}
+    , Dropped{}
+    , Bytes{}
+    , RawBytes{}
+    , Depth{}
+    , MaxDepth{}
+{
+}
+
+Recorder::~Recorder()
+{
+    Close();
+}
+
+bool Recorder::Open(SDL_GPUDevice* device, const char* path, const glm::ivec3& size, CompressionType compression, float errorBound)
+{
+    Close();
+    Uint64 fieldSize = Uint64(size.x) * size.y * size.z * sizeof(float);
+    if (fieldSize > SDL_MAX_UINT32)
+    {
+        SDL_Log("Grid too large to record: %d, %d, %d", size.x, size.y, size.z);
+        return false;
+    }
+    Device = device;
+    Size = size;
+    Compression = compression;
+    ErrorBound = errorBound;
+    File.open(path, std::ios::binary);
+    if (!File)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    RecordingHeader header{};
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = kVersion;
+    header.Size[0] = size.x;
+    header.Size[1] = size.y;
+    header.Size[2] = size.z;
+    header.Compression = compression;
+    header.ErrorBound = errorBound;
+    File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    SDL_GPUTransferBufferCreateInfo info{};
+    info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+    info.size = Uint32(fieldSize);
+    for (int i = 0; i < kSlots; i++)
+    {
+        TransferBuffers[i] = SDL_CreateGPUTransferBuffer(Device, &info);
+        if (!TransferBuffers[i])
+        {
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            Close();
+            return false;
+        }
+        Slots.Push(int(i));
+    }
+    Written = 0;
+    Dropped = 0;
+    Bytes = sizeof(header);
+    RawBytes = sizeof(header);
+    Depth = 0;
+    MaxDepth = 0;
+    if (Compression != CompressionTypeNone)
+    {
+        Pool.Create(0);
+    }
+    Thread = std::thread(&Recorder::Run, this);
+    Opened = true;
+    return true;
+}
+
+void Recorder::Close()
+{
+    if (Thread.joinable())
+    {
+        Available.release();
+        Thread.join();
+    }
+    int slot;
+    while (Slots.Pop(slot))
+    {
+    }
+    for (int i = 0; i < kSlots; i++)
+    {
+        if (TransferBuffers[i])
+        {
+            SDL_ReleaseGPUTransferBuffer(Device, TransferBuffers[i]);
+            TransferBuffers[i] = nullptr;
+        }
+    }
+    File.close();
+    Pool.Free();
+    Buffer.clear();
+    Buffer.shrink_to_fit();
+    Opened = false;
+}
+
+bool Recorder::IsOpen() const
+{
+    return Opened;
+}
+
+const glm::ivec3& Recorder::GetSize() const
+{
+    return Size;
+}
+
+SDL_GPUTransferBuffer* Recorder::Acquire(int& slot)
+{
+    if (!Slots.Pop(slot))
+    {
+        Dropped++;
+        return nullptr;
+    }
+    return TransferBuffers[slot];
+}
+
+void Recorder::Submit(int slot, SDL_GPUFence* fence, Uint64 step)
+{
+    Downloads.Push({slot, fence, step});
+    int depth = ++Depth;
+    MaxDepth = std::max(MaxDepth.load(), depth);
+    Available.release();
+}
+
+Uint64 Recorder::GetWritten() const
+{
+    return Written;
+}
+
+Uint64 Recorder::GetDropped() const
+{
+    return Dropped;
+}
+
+Uint64 Recorder::GetBytes() const
+{
+    return Bytes;
+}
+
+Uint64 Recorder::GetRawBytes() const
+{
+    return RawBytes;
+}
+
+int Recorder::GetDepth() const
+{
+    return Depth;
+}
+
+int Recorder::GetMaxDepth() const
+{
+    return MaxDepth;
+}
+
+void Recorder::Run()
+{
+    while (true)
+    {
+        Available.acquire();
+        Download download;
+        if (!Downloads.Pop(download))
+        {
+            return;
+        }
+        Write(download);
+    }
+}
+
+void Recorder::Write(const Download& download)
+{
+    int slot = download.Slot;
+    SDL_GPUFence* fence = download.Fence;
+    if (!fence)
+    {
+        Dropped++;
+        Depth--;
+        Slots.Push(std::move(slot));
+        return;
+    }
+    SDL_WaitForGPUFences(Device, true, &fence, 1);
+    SDL_ReleaseGPUFence(Device, fence);
+    RecordingFrameHeader header{};
+    header.Step = download.Step;
+    Uint64 count = Uint64(Size.x) * Size.y * Size.z;
+    header.Size = count * sizeof(float);
+    void* data = SDL_MapGPUTransferBuffer(Device, TransferBuffers[download.Slot], false);
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        Dropped++;
+    }
+    else
+    {
+        const char* frame = static_cast<const char*>(data);
+        if (Compression != CompressionTypeNone)
+        {
+            Compress(Pool, Compression, ErrorBound, static_cast<const float*>(data), count, Buffer);
+            frame = reinterpret_cast<const char*>(Buffer.data());
+            header.Size = Buffer.size();
+        }
+        File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        File.write(frame, header.Size);
+        SDL_UnmapGPUTransferBuffer(Device, TransferBuffers[download.Slot]);
+        if (!File)
+        {
+            SDL_Log("Failed to write frame: %" SDL_PRIu64, download.Step);
+            Dropped++;
+            File.clear();
+        }
+        else
+        {
+            Written++;
+            Bytes += sizeof(header) + header.Size;
+            RawBytes += sizeof(header) + count * sizeof(float);
+        }
+    }
+    Depth--;
+    Slots.Push(std::move(slot));
+}
\ No newline at end of file
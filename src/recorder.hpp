@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+#include "compress.hpp"
+#include "pool.hpp"
+#include "queue.hpp"
+
+struct RecordingHeader
+{
+    char Magic[4];
+    Uint32 Version;
+    Sint32 Size[3];
+    Uint32 Compression;
+    float ErrorBound;
+};
+
+struct RecordingFrameHeader
+{
+    Uint64 Step;
+    Uint64 Size;
+};
+
+class Recorder
+{
+public:
+    Recorder();
+    ~Recorder();
+    bool Open(SDL_GPUDevice* device, const char* path, const glm::ivec3& size, CompressionType compression, float errorBound);
+    void Close();
+    bool IsOpen() const;
+    const glm::ivec3& GetSize() const;
+    SDL_GPUTransferBuffer* Acquire(int& slot);
+    void Submit(int slot, SDL_GPUFence* fence, Uint64 step);
+    Uint64 GetWritten() const;
+    Uint64 GetDropped() const;
+    Uint64 GetBytes() const;
+    Uint64 GetRawBytes() const;
+    int GetDepth() const;
+    int GetMaxDepth() const;
+
+    static constexpr int kSlots = 4;
+
+private:
+    struct Download
+    {
+        int Slot;
+        SDL_GPUFence* Fence;
+        Uint64 Step;
+    };
+
+    void Run();
+    void Write(const Download& download);
+
+    SDL_GPUDevice* Device;
+    SDL_GPUTransferBuffer* TransferBuffers[kSlots];
+    SpscQueue<int, kSlots + 1> Slots;
+    SpscQueue<Download, kSlots + 1> Downloads;
+    std::counting_semaphore<> Available;
+    std::thread Thread;
+    std::ofstream File;
+    ThreadPool Pool;
+    std::vector<Uint8> Buffer;
+    glm::ivec3 Size;
+    CompressionType Compression;
+    float ErrorBound;
+    std::atomic<bool> Opened;
+    std::atomic<Uint64> Written;
+    std::atomic<Uint64> Dropped;
+    std::atomic<Uint64> Bytes;
+    std::atomic<Uint64> RawBytes;
+    std::atomic<int> Depth;
+    std::atomic<int> MaxDepth;
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <SDL3/SDL.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+
+#include "state.hpp"
+
+static void SortTimeline(std::vector<TimelineEvent>& timeline)
+{
+    std::stable_sort(timeline.begin(), timeline.end(), [](const TimelineEvent& lhs, const TimelineEvent& rhs)
+    {
+        return lhs.Step < rhs.Step;
+    });
+}
+
+bool LoadState(const char* path, State& state)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    nlohmann::json json;
+    try
+    {
+        file >> json;
+        state = json;
+        SortTimeline(state.Timeline);
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to load json: %s, %s", path, exception.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadTimeline(const char* path, std::vector<TimelineEvent>& timeline)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    nlohmann::json json;
+    try
+    {
+        file >> json;
+        timeline = json;
+        SortTimeline(timeline);
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to load json: %s, %s", path, exception.what());
+        return false;
+    }
+    return true;
+}
+
+bool SaveState(const char* path, const State& state)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        SDL_Log("Failed to open file: %s", path);
+        return false;
+    }
+    try
+    {
+        nlohmann::json json = state;
+        file << json.dump(4);
+    }
+    catch (const std::exception& exception)
+    {
+        SDL_Log("Failed to save json: %s, %s", path, exception.what());
+        return false;
+    }
+    return true;
+}
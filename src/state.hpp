@@ -0,0 +1,73 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <vector>
+
+enum TextureType
+{
+    TextureTypeVelocityX,
+    TextureTypeVelocityY,
+    TextureTypeVelocityZ,
+    TextureTypePressure,
+    TextureTypeDivergence,
+    TextureTypeDensity,
+    TextureTypeCount,
+};
+
+enum TimelineEventType
+{
+    TimelineEventTypeSpawnerOn,
+    TimelineEventTypeSpawnerOff,
+    TimelineEventTypeBrush,
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(TimelineEventType,
+{
+    {TimelineEventTypeSpawnerOn, "SpawnerOn"},
+    {TimelineEventTypeSpawnerOff, "SpawnerOff"},
+    {TimelineEventTypeBrush, "Brush"},
+})
+
+struct Spawner
+{
+    TextureType Texture;
+    std::array<int, 3> Position;
+    float Value;
+    bool Enabled = true;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Spawner, Texture, Position, Value, Enabled)
+};
+
+struct TimelineEvent
+{
+    int Step = 0;
+    TimelineEventType Type = TimelineEventTypeBrush;
+    int Spawner = 0;
+    std::array<float, 3> Position{};
+    std::array<float, 3> Velocity{};
+    float Radius = 8.0f;
+    float Dye = 0.0f;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(TimelineEvent, Step, Type, Spawner, Position, Velocity, Radius, Dye)
+};
+
+// Steps, Iterations and DeltaTime keep the current settings at 0, Diffusion and Viscosity at -1 (0 is valid)
+struct State
+{
+    std::array<int, 3> Size{128, 128, 128};
+    std::vector<Spawner> Spawners;
+    int Steps = 0;
+    int Iterations = 0;
+    float DeltaTime = 0.0f;
+    float Diffusion = -1.0f;
+    float Viscosity = -1.0f;
+    std::vector<TimelineEvent> Timeline;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(State, Size, Spawners, Steps, Iterations, DeltaTime, Diffusion, Viscosity, Timeline)
+};
+
+bool LoadState(const char* path, State& state);
+bool LoadTimeline(const char* path, std::vector<TimelineEvent>& timeline);
+bool SaveState(const char* path, const State& state);
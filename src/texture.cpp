@@ -2,7 +2,7 @@
 
 #include "texture.hpp"
 
-bool ReadWriteTexture::Create(SDL_GPUDevice* device, int size)
+bool ReadWriteTexture::Create(SDL_GPUDevice* device, const glm::ivec3& size)
 {
     Free(device);
     SDL_GPUTextureCreateInfo info{};
@@ -10,9 +10,9 @@ bool ReadWriteTexture::Create(SDL_GPUDevice* device, int size)
     info.type = SDL_GPU_TEXTURETYPE_3D;
     info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ |
         SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_SIMULTANEOUS_READ_WRITE;
-    info.width = size;
-    info.height = size;
-    info.layer_count_or_depth = size;
+    info.width = size.x;
+    info.height = size.y;
+    info.layer_count_or_depth = size.z;
     info.num_levels = 1;
     for (int i = 0; i < 2; i++)
     {
@@ -23,6 +23,7 @@ bool ReadWriteTexture::Create(SDL_GPUDevice* device, int size)
             return false;
         }
     }
+    Size = size;
     return true;
 }
 
@@ -64,3 +65,8 @@ SDL_GPUTexture* ReadWriteTexture::GetWriteTexture()
 {
     return Textures[(ReadIndex + 1) % 2];
 }
+
+const glm::ivec3& ReadWriteTexture::GetSize() const
+{
+    return Size;
+}
\ No newline at end of file
@@ -1,20 +1,23 @@
 #pragma once
 
 #include <SDL3/SDL.h>
+#include <glm/glm.hpp>
 
 class ReadWriteTexture
 {
 public:
-    ReadWriteTexture() : Textures{}, ReadIndex{} {}
-    bool Create(SDL_GPUDevice* device, int size);
+    ReadWriteTexture() : Textures{}, ReadIndex{}, Size{} {}
+    bool Create(SDL_GPUDevice* device, const glm::ivec3& size);
     void Free(SDL_GPUDevice* device);
     SDL_GPUComputePass* BeginReadPass(SDL_GPUCommandBuffer* commandBuffer);
     SDL_GPUComputePass* BeginWritePass(SDL_GPUCommandBuffer* commandBuffer);
     void Swap();
     SDL_GPUTexture* GetReadTexture();
     SDL_GPUTexture* GetWriteTexture();
+    const glm::ivec3& GetSize() const;
 
 private:
     SDL_GPUTexture* Textures[2];
     int ReadIndex;
+    glm::ivec3 Size;
 };
\ No newline at end of file